@@ -0,0 +1,140 @@
+#include "../zlog/zlog.h"
+#include <cstdlib>
+#include <new>
+
+/*
+    稳态热路径零分配检查
+        1. 替换全局 operator new/delete，统计计数窗口内的堆分配次数(含后台线程)
+        2. 每个线程先预热，使线程局部缓冲区、文件流缓冲区等完成初始分配
+        3. 计数窗口内任何一次分配都视为失败，进程返回非0
+*/
+static std::atomic<bool> g_counting(false);
+static std::atomic<size_t> g_allocs(0);
+
+void *operator new(size_t size)
+{
+    if (g_counting.load(std::memory_order_relaxed))
+        g_allocs.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
+
+static const size_t kWarmup = 5000;
+static const size_t kMessages = 50000;
+
+// 所有生产线程预热完毕后开启计数，全部结束后关闭
+size_t run(const zlog::Logger::ptr &logger, size_t threadNum)
+{
+    std::atomic<size_t> ready(0);
+    std::atomic<size_t> done(0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threadNum; ++i)
+    {
+        threads.emplace_back([&, i]()
+                             {
+            zlog::setThreadName(fmt::format("producer-{}", i));
+            zlog::MDC::put("req", "r-0001");
+            int user = 42;
+            double lat = 1.5;
+            for (size_t j = 0; j < kWarmup; ++j)
+            {
+                logger->ZLOG_INFO("warmup {} {}", j, "payload");
+                logger->ZLOG_INFO_KV("warmup", zlog::kv("user", user), zlog::kv("lat_us", lat));
+            }
+            ready++;
+            while (!g_counting.load())
+                std::this_thread::yield();
+
+            for (size_t j = 0; j < kMessages; ++j)
+            {
+                logger->ZLOG_INFO("message {} {}", j, "payload");
+                logger->ZLOG_INFO_KV("message", zlog::kv("user", user), zlog::kv("lat_us", lat));
+            }
+            done++; });
+    }
+
+    while (ready.load() != threadNum)
+        std::this_thread::yield();
+    // 等待后台线程至少完成一轮落地
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    g_allocs = 0;
+    g_counting = true;
+    while (done.load() != threadNum)
+        std::this_thread::yield();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    g_counting = false;
+
+    for (auto &t : threads)
+        t.join();
+    return g_allocs.load();
+}
+
+zlog::Logger::ptr build(const char *name, zlog::LoggerType type, bool unsafe, bool staged, const std::string &path)
+{
+    std::unique_ptr<zlog::LocalLoggerBuilder> builder(new zlog::LocalLoggerBuilder());
+    builder->buildLoggerName(name);
+    builder->buildLoggerFormatter("[%d{%H:%M:%S}][%t][%t{tid}][%N][%c][%f:%l][%p][%X]%T%m %j%n");
+    builder->buildLoggerType(type);
+    builder->buildWaitTime(std::chrono::milliseconds(10));
+    if (unsafe)
+        builder->buildEnalleUnSafe();
+    if (staged)
+        builder->buildWriteCombining();
+    builder->buildLoggerSink<zlog::FileSink>(path);
+    return builder->build();
+}
+
+int main()
+{
+    struct Case
+    {
+        const char *name;
+        zlog::LoggerType type;
+        bool unsafe;
+        bool staged;
+        const char *path;
+    } cases[] = {
+        {"sync", zlog::LoggerType::LOGGER_SYNC, false, false, "./logfile/alloc_sync.log"},
+        {"async_safe", zlog::LoggerType::LOGGER_ASYNC, false, false, "./logfile/alloc_async_safe.log"},
+        {"async_unsafe", zlog::LoggerType::LOGGER_ASYNC, true, false, "./logfile/alloc_async_unsafe.log"},
+        {"async_staged", zlog::LoggerType::LOGGER_ASYNC, false, true, "./logfile/alloc_async_staged.log"},
+    };
+
+    int failed = 0;
+    for (auto &c : cases)
+    {
+        zlog::Logger::ptr logger = build(c.name, c.type, c.unsafe, c.staged, c.path);
+        size_t allocs = run(logger, 4);
+        std::cout << c.name << ":\t" << allocs << " allocations" << (allocs == 0 ? "" : "  <-- FAILED") << std::endl;
+        if (allocs != 0)
+            failed = 1;
+    }
+    return failed;
+}
@@ -0,0 +1,347 @@
+#include "../zlog/zlog.h"
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+    单次调用延迟分布测试
+        1. 以rdtsc记录每次日志调用的耗时，写入HDR风格的对数-线性直方图(相对误差约3%)
+        2. 每个线程输出p50/p99/p99.9/max，另给出所有线程合并后的分布
+        3. 覆盖 同步/异步安全/异步非安全 × 落地方向 × 消息长度 × 线程数 的组合，结果可输出为JSON用于版本间对比
+    用法: ./latency_bench [--types sync,async_safe,async_unsafe] [--sinks file,roll,append,console]
+                          [--sizes 32,256,1024] [--threads 1,4] [--messages 10000] [--dir ./logfile/latency] [--json out.json]
+*/
+
+// 时间戳计数器；非x86平台退化为steady_clock纳秒
+static inline uint64_t ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+#endif
+}
+
+// 每纳秒的计数，以steady_clock校准
+static double ticksPerNs()
+{
+    auto begin = std::chrono::steady_clock::now();
+    uint64_t start = ticks();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    uint64_t end = ticks();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+    return (end - start) / ns;
+}
+
+// 对数-线性直方图：每个2的幂区间再等分为SUB个子桶
+class LatencyHistogram
+{
+public:
+    static const int SUB_BITS = 5;
+    static const uint64_t SUB = 1ULL << SUB_BITS;
+    static const size_t BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+    LatencyHistogram()
+        : counts_(BUCKETS, 0), count_(0), sum_(0), max_(0)
+    {
+    }
+
+    void record(uint64_t value)
+    {
+        counts_[index(value)]++;
+        count_++;
+        sum_ += value;
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const LatencyHistogram &other)
+    {
+        for (size_t i = 0; i < BUCKETS; ++i)
+            counts_[i] += other.counts_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    // 分位数所在子桶的上界，不超过最大值
+    uint64_t percentile(double p) const
+    {
+        if (count_ == 0)
+            return 0;
+        uint64_t rank = static_cast<uint64_t>(std::ceil(p * count_));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= rank && counts_[i] > 0)
+                return std::min(upper(i), max_);
+        }
+        return max_;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ == 0 ? 0 : static_cast<double>(sum_) / count_; }
+
+private:
+    static size_t index(uint64_t value)
+    {
+        if (value < 2 * SUB)
+            return static_cast<size_t>(value);
+        int shift = 63 - __builtin_clzll(value) - SUB_BITS;
+        return static_cast<size_t>(shift) * SUB + static_cast<size_t>(value >> shift);
+    }
+
+    static uint64_t upper(size_t index)
+    {
+        if (index < 2 * SUB)
+            return index;
+        size_t shift = index / SUB - 1;
+        uint64_t mantissa = index - shift * SUB;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    std::vector<uint64_t> counts_;
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t max_;
+};
+
+struct Options
+{
+    std::vector<std::string> types_ = {"sync", "async_safe", "async_unsafe"};
+    std::vector<std::string> sinks_ = {"file", "roll", "append", "console"};
+    std::vector<size_t> sizes_ = {32, 256, 1024};
+    std::vector<size_t> threads_ = {1, 4};
+    size_t messages_ = 10000; // 每个线程
+    std::string dir_ = "./logfile/latency";
+    std::string json_;
+};
+
+struct Result
+{
+    std::string type_;
+    std::string sink_;
+    size_t size_ = 0;
+    size_t threads_ = 0;
+    double seconds_ = 0; // 生产阶段耗时
+    double drainSeconds_ = 0; // 调用flush到全部落地的耗时
+    std::vector<LatencyHistogram> perThread_;
+    LatencyHistogram all_;
+};
+
+static std::vector<std::string> split(const std::string &value)
+{
+    std::vector<std::string> items;
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+static bool addSink(zlog::LocalLoggerBuilder &builder, const std::string &sink, const std::string &path)
+{
+    if (sink == "file")
+        builder.buildLoggerSink<zlog::FileSink>(path);
+    else if (sink == "roll")
+        builder.buildLoggerSink<zlog::RollBySizeSink>(path + "-", 64 * 1024 * 1024);
+#ifndef _WIN32
+    else if (sink == "append")
+        builder.buildLoggerSink<zlog::AppendFileSink>(path);
+    else if (sink == "console")
+    {
+        // 写入/dev/null，只测量日志库自身的开销
+        static int devNull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+        builder.buildLoggerSink<zlog::ConsoleSink>(zlog::ConsolePolicy::BLOCK, 0, devNull);
+    }
+#endif
+    else if (sink == "stdout")
+        builder.buildLoggerSink<zlog::StdOutSink>();
+    else
+        return false;
+    return true;
+}
+
+static bool runCase(const Options &options, Result &result)
+{
+    std::string name = fmt::format("latency-{}-{}-{}-{}", result.type_, result.sink_, result.size_, result.threads_);
+    zlog::LocalLoggerBuilder builder;
+    builder.buildLoggerName(name.c_str());
+    builder.buildLoggerFormatter("%d{%H:%M:%S} [%t][%p] %m%n");
+    if (result.type_ == "sync")
+        builder.buildLoggerType(zlog::LoggerType::LOGGER_SYNC);
+    else if (result.type_ == "async_safe")
+        builder.buildLoggerType(zlog::LoggerType::LOGGER_ASYNC);
+    else if (result.type_ == "async_unsafe")
+    {
+        builder.buildLoggerType(zlog::LoggerType::LOGGER_ASYNC);
+        builder.buildEnalleUnSafe();
+    }
+    else
+    {
+        std::cerr << "未知的日志器类型: " << result.type_ << std::endl;
+        return false;
+    }
+    if (!addSink(builder, result.sink_, options.dir_ + "/" + name + ".log"))
+    {
+        std::cerr << "未知的落地方向: " << result.sink_ << std::endl;
+        return false;
+    }
+    zlog::Logger::ptr logger = builder.build();
+
+    std::string msg(result.size_, 'A');
+    result.perThread_.assign(result.threads_, LatencyHistogram());
+    std::atomic<size_t> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < result.threads_; ++i)
+    {
+        threads.emplace_back([&, i]()
+                             {
+            LatencyHistogram &hist = result.perThread_[i];
+            // 预热线程局部缓冲区
+            for (size_t j = 0; j < 100; ++j)
+                logger->ZLOG_INFO("{} {}", j, msg);
+            ready++;
+            while (!go.load())
+                std::this_thread::yield();
+            for (size_t j = 0; j < options.messages_; ++j)
+            {
+                uint64_t begin = ticks();
+                logger->ZLOG_INFO("{} {}", j, msg);
+                hist.record(ticks() - begin);
+            } });
+    }
+    while (ready.load() != result.threads_)
+        std::this_thread::yield();
+
+    auto begin = std::chrono::steady_clock::now();
+    go = true;
+    for (auto &thread : threads)
+        thread.join();
+    auto produced = std::chrono::steady_clock::now();
+    logger->flush().wait();
+    auto drained = std::chrono::steady_clock::now();
+
+    result.seconds_ = std::chrono::duration<double>(produced - begin).count();
+    result.drainSeconds_ = std::chrono::duration<double>(drained - produced).count();
+    for (auto &hist : result.perThread_)
+        result.all_.merge(hist);
+    return true;
+}
+
+static void histogramJson(fmt::memory_buffer &out, const LatencyHistogram &hist, double tpn)
+{
+    fmt::format_to(std::back_inserter(out), "{{\"count\":{},\"mean_ns\":{:.1f},\"p50_ns\":{:.0f},\"p99_ns\":{:.0f},\"p999_ns\":{:.0f},\"max_ns\":{:.0f}}}",
+                   hist.count(), hist.mean() / tpn, hist.percentile(0.5) / tpn, hist.percentile(0.99) / tpn,
+                   hist.percentile(0.999) / tpn, hist.max() / tpn);
+}
+
+static std::string toJson(const std::vector<Result> &results, const Options &options, double tpn)
+{
+    fmt::memory_buffer out;
+    auto it = std::back_inserter(out);
+    fmt::format_to(it, "{{\"ticks_per_ns\":{:.4f},\"messages_per_thread\":{},\"hardware_threads\":{},\"runs\":[",
+                   tpn, options.messages_, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &r = results[i];
+        fmt::format_to(it, "{}\n{{\"type\":\"{}\",\"sink\":\"{}\",\"size\":{},\"threads\":{},\"seconds\":{:.6f},\"drain_seconds\":{:.6f},\"msgs_per_sec\":{:.0f},\"all\":",
+                       i == 0 ? "" : ",", r.type_, r.sink_, r.size_, r.threads_, r.seconds_, r.drainSeconds_,
+                       r.seconds_ > 0 ? r.all_.count() / r.seconds_ : 0);
+        histogramJson(out, r.all_, tpn);
+        fmt::format_to(it, ",\"per_thread\":[");
+        for (size_t t = 0; t < r.perThread_.size(); ++t)
+        {
+            if (t != 0)
+                out.push_back(',');
+            histogramJson(out, r.perThread_[t], tpn);
+        }
+        fmt::format_to(it, "]}}");
+    }
+    fmt::format_to(it, "\n]}}\n");
+    return std::string(out.data(), out.size());
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--types")
+            options.types_ = split(value);
+        else if (key == "--sinks")
+            options.sinks_ = split(value);
+        else if (key == "--sizes" || key == "--threads")
+        {
+            std::vector<size_t> numbers;
+            for (auto &item : split(value))
+                numbers.push_back(std::stoul(item));
+            (key == "--sizes" ? options.sizes_ : options.threads_) = numbers;
+        }
+        else if (key == "--messages")
+            options.messages_ = std::stoul(value);
+        else if (key == "--dir")
+            options.dir_ = value;
+        else if (key == "--json")
+            options.json_ = value;
+        else
+        {
+            std::cout << "用法: " << argv[0] << " [--types t1,t2] [--sinks s1,s2] [--sizes n1,n2] [--threads n1,n2]"
+                      << " [--messages n] [--dir path] [--json out.json]" << std::endl;
+            return -1;
+        }
+    }
+    zlog::File::createDirectory(options.dir_);
+
+    double tpn = ticksPerNs();
+    std::cout << fmt::format("{:<13} {:<8} {:>6} {:>7} {:>12} {:>9} {:>9} {:>9} {:>10}\n", "type", "sink", "size", "threads",
+                             "msgs/s", "p50(ns)", "p99(ns)", "p99.9(ns)", "max(ns)");
+    std::vector<Result> results;
+    for (auto &type : options.types_)
+        for (auto &sink : options.sinks_)
+            for (size_t size : options.sizes_)
+                for (size_t threadNum : options.threads_)
+                {
+                    Result result;
+                    result.type_ = type;
+                    result.sink_ = sink;
+                    result.size_ = size;
+                    result.threads_ = threadNum;
+                    if (!runCase(options, result))
+                        return -1;
+                    const LatencyHistogram &all = result.all_;
+                    std::cout << fmt::format("{:<13} {:<8} {:>6} {:>7} {:>12.0f} {:>9.0f} {:>9.0f} {:>9.0f} {:>10.0f}\n", type, sink, size, threadNum,
+                                             all.count() / result.seconds_, all.percentile(0.5) / tpn, all.percentile(0.99) / tpn,
+                                             all.percentile(0.999) / tpn, all.max() / tpn);
+                    for (size_t t = 0; t < result.perThread_.size() && threadNum > 1; ++t)
+                    {
+                        const LatencyHistogram &hist = result.perThread_[t];
+                        std::cout << fmt::format("{:>38}{:<2} {:>12} {:>9.0f} {:>9.0f} {:>9.0f} {:>10.0f}\n", "thread ", t, "",
+                                                 hist.percentile(0.5) / tpn, hist.percentile(0.99) / tpn,
+                                                 hist.percentile(0.999) / tpn, hist.max() / tpn);
+                    }
+                    results.push_back(std::move(result));
+                }
+
+    if (!options.json_.empty())
+    {
+        std::ofstream ofs(options.json_);
+        ofs << toJson(results, options, tpn);
+        if (!ofs.good())
+        {
+            std::cerr << "写入JSON失败: " << options.json_ << std::endl;
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,214 @@
+#include "../zlog/zlog.h"
+#include <functional>
+
+/*
+    组件微基准
+        1. 模式解析：Formatter构造(parsePattern + 创建格式化子项)
+        2. 每个FormatItem单独格式化一条消息
+        3. Buffer::push：从小容量开始逐步扩容，以及容量足够时的稳态写入
+        4. AsyncLooper：空消费者下的写入吞吐，以及一次写入到落地完成的往返(含缓冲区交换与唤醒)
+        5. 每个LogSink::log写入一条记录
+    用法: ./micro_bench [过滤子串] [--dir ./logfile/micro]
+*/
+
+// 阻止编译器优化掉被测结果
+template <typename T>
+static inline void keep(T const &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+static std::string g_filter;
+
+// 自动调整迭代次数使单项耗时约200ms，输出每次操作的纳秒数
+static void measure(const std::string &name, const std::function<void(size_t)> &body)
+{
+    if (!g_filter.empty() && name.find(g_filter) == std::string::npos)
+        return;
+    using Clock = std::chrono::steady_clock;
+    size_t iterations = 1;
+    double seconds = 0;
+    while (true)
+    {
+        auto begin = Clock::now();
+        body(iterations);
+        seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+        if (seconds >= 0.2 || iterations >= (1ULL << 30))
+            break;
+        iterations = seconds < 0.01 ? iterations * 10 : static_cast<size_t>(iterations * 0.25 / seconds) + 1;
+    }
+    std::cout << fmt::format("{:<36} {:>12.1f} ns/op {:>12} iterations\n", name, seconds * 1e9 / iterations, iterations);
+}
+
+static void benchPattern()
+{
+    const char *patterns[][2] = {
+        {"pattern/default", "[%d{%H:%M:%S}][%t][%c][%f:%l][%p]%T%m%n"},
+        {"pattern/minimal", "%m%n"},
+        {"pattern/json", "{\"ts\":\"%d{%Y-%m-%dT%H:%M:%S}\",\"level\":\"%p\",\"msg\":\"%m{json}\",%j}%n"},
+    };
+    for (auto &pattern : patterns)
+    {
+        std::string text = pattern[1];
+        measure(pattern[0], [&text](size_t n)
+                {
+            for (size_t i = 0; i < n; ++i)
+            {
+                zlog::Formatter formatter(text);
+                keep(formatter);
+            } });
+    }
+}
+
+static void benchFormatItems()
+{
+    const char *payload = "user login succeeded \"quoted\"\tand tabbed";
+    zlog::LogMessage msg(zlog::LogLevel::value::INFO, __FILE__, __LINE__, payload, "micro");
+    int user = 42;
+    double lat = 1.5;
+    std::string region = "cn-north";
+    zlog::KvField fields[] = {zlog::kv("user", user).field(), zlog::kv("lat_us", lat).field(), zlog::kv("region", region).field()};
+    msg.fields_ = fields;
+    msg.fieldCount_ = 3;
+    zlog::MDC::put("req", "r-0001");
+
+    std::vector<std::pair<std::string, zlog::FormatItem::prt>> items = {
+        {"item/message", std::make_shared<zlog::MessageFormatItem>()},
+        {"item/message{json}", std::make_shared<zlog::MessageFormatItem>(zlog::MessageFormatItem::Mode::JSON)},
+        {"item/message{line}", std::make_shared<zlog::MessageFormatItem>(zlog::MessageFormatItem::Mode::LINE)},
+        {"item/level", std::make_shared<zlog::LevelFormatItem>()},
+        {"item/time", std::make_shared<zlog::TimeFormatItem>()},
+        {"item/time{iso}", std::make_shared<zlog::TimeFormatItem>("%Y-%m-%dT%H:%M:%S")},
+        {"item/file", std::make_shared<zlog::FileFormatItem>()},
+        {"item/line", std::make_shared<zlog::LineFormatItem>()},
+        {"item/thread", std::make_shared<zlog::ThreadIdFormatItem>()},
+        {"item/thread{tid}", std::make_shared<zlog::ThreadIdFormatItem>(true)},
+        {"item/thread_name", std::make_shared<zlog::ThreadNameFormatItem>()},
+        {"item/logger", std::make_shared<zlog::LoggerFormatItem>()},
+        {"item/json_fields", std::make_shared<zlog::JsonFieldsFormatItem>()},
+        {"item/logfmt_fields", std::make_shared<zlog::LogfmtFieldsFormatItem>()},
+        {"item/mdc", std::make_shared<zlog::MdcFormatItem>()},
+        {"item/mdc{key}", std::make_shared<zlog::MdcFormatItem>("req")},
+        {"item/tab", std::make_shared<zlog::TabFormatItem>()},
+        {"item/newline", std::make_shared<zlog::NLineFormatItem>()},
+        {"item/other", std::make_shared<zlog::OtherFormatItem>("] [")},
+    };
+    fmt::memory_buffer buffer;
+    for (auto &item : items)
+    {
+        zlog::FormatItem::prt format = item.second;
+        measure(item.first, [&](size_t n)
+                {
+            for (size_t i = 0; i < n; ++i)
+            {
+                buffer.clear();
+                format->format(buffer, msg);
+                keep(buffer.data());
+            } });
+    }
+
+    zlog::Formatter formatter;
+    measure("formatter/default", [&](size_t n)
+            {
+        for (size_t i = 0; i < n; ++i)
+        {
+            buffer.clear();
+            formatter.format(buffer, msg);
+            keep(buffer.data());
+        } });
+}
+
+static void benchBuffer()
+{
+    std::string record(100, 'A');
+    // 从4KB增长到16MB，计入全部扩容
+    measure("buffer/push_growth_4K_to_16M", [&](size_t n)
+            {
+        const size_t pushes = 16 * 1024 * 1024 / record.size();
+        for (size_t i = 0; i < n; ++i)
+        {
+            zlog::Buffer buffer(4096);
+            for (size_t j = 0; j < pushes; ++j)
+                buffer.push(record.data(), record.size());
+            keep(buffer.readAbleSize());
+        } });
+    zlog::Buffer buffer;
+    measure("buffer/push_steady_100B", [&](size_t n)
+            {
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (buffer.writeAbleSize() < record.size())
+                buffer.reset();
+            buffer.push(record.data(), record.size());
+        }
+        keep(buffer.readAbleSize()); });
+}
+
+static void benchLooper()
+{
+    std::string record(100, 'A');
+    for (int safe = 1; safe >= 0; --safe)
+    {
+        zlog::AsyncType type = safe ? zlog::AsyncType::ASYNC_SAFE : zlog::AsyncType::ASYNC_UNSAFE;
+        zlog::AsyncLooper looper([](zlog::Buffer &buffer)
+                                 { keep(buffer.readAbleSize()); },
+                                 type, std::chrono::milliseconds(3000));
+        measure(safe ? "looper/push_safe_100B" : "looper/push_unsafe_100B", [&](size_t n)
+                {
+            for (size_t i = 0; i < n; ++i)
+                looper.push(record.data(), record.size());
+            looper.drain(); });
+        // 一次写入后等待落地：包含唤醒消费者、交换缓冲区与回调通知
+        measure(safe ? "looper/swap_roundtrip_safe" : "looper/swap_roundtrip_unsafe", [&](size_t n)
+                {
+            for (size_t i = 0; i < n; ++i)
+            {
+                looper.push(record.data(), record.size());
+                looper.drain();
+            } });
+        looper.stop();
+    }
+}
+
+static void benchSinks(const std::string &dir)
+{
+    std::string record = std::string(99, 'A') + "\n";
+    std::vector<std::pair<std::string, zlog::LogSink::ptr>> sinks = {
+        {"sink/file", std::make_shared<zlog::FileSink>(dir + "/file.log")},
+        {"sink/roll", std::make_shared<zlog::RollBySizeSink>(dir + "/roll", 64 * 1024 * 1024)},
+#ifndef _WIN32
+        {"sink/append", std::make_shared<zlog::AppendFileSink>(dir + "/append.log")},
+        {"sink/console_devnull", std::make_shared<zlog::ConsoleSink>(zlog::ConsolePolicy::BLOCK, 0, open("/dev/null", O_WRONLY | O_CLOEXEC))},
+#endif
+    };
+    for (auto &sink : sinks)
+    {
+        zlog::LogSink::ptr target = sink.second;
+        measure(sink.first, [&](size_t n)
+                {
+            for (size_t i = 0; i < n; ++i)
+                target->log(record.data(), record.size());
+            target->flush(); });
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::string dir = "./logfile/micro";
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--dir" && i + 1 < argc)
+            dir = argv[++i];
+        else
+            g_filter = arg;
+    }
+    zlog::File::createDirectory(dir);
+
+    benchPattern();
+    benchFormatItems();
+    benchBuffer();
+    benchLooper();
+    benchSinks(dir);
+    return 0;
+}
@@ -0,0 +1,297 @@
+#include "../zlog/zlog.h"
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#ifndef _WIN32
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+/*
+    长时间浸泡与顺序校验
+        1. 多个生产线程持续写入带序号的记录("<线程> <序号> <填充>")，默认不限速以保持过载
+        2. 按固定间隔采样吞吐、等待落地的数据量与RSS，结束时给出吞吐漂移与内存变化
+        3. 全部落地后读回日志文件，逐线程校验序号：无丢失、无重复、线程内无乱序
+    用法: ./soak [--type safe|unsafe] [--threads 8] [--seconds 60] [--size 100] [--interval 5]
+                 [--rate 0] [--sink file|roll] [--dir ./logfile/soak] [--numa 0] [--stage 0]
+    rate为每个线程每秒的记录数，0表示不限速；numa为1时按NUMA节点分片；stage为写合并暂存区字节数，0表示关闭
+    校验失败时返回非0
+*/
+
+struct Options
+{
+    std::string type_ = "safe";
+    size_t threads_ = 8;
+    size_t seconds_ = 60;
+    size_t size_ = 100;
+    size_t interval_ = 5;
+    size_t rate_ = 0;
+    std::string sink_ = "file";
+    std::string dir_ = "./logfile/soak";
+    bool numa_ = false;
+    size_t stage_ = 0;
+};
+
+struct Sample
+{
+    double elapsed_ = 0;
+    double rate_ = 0; // 区间内每秒记录数
+    size_t rss_ = 0;  // 字节
+    size_t pending_ = 0;
+};
+
+// 当前进程的常驻内存
+static size_t residentBytes()
+{
+#ifndef _WIN32
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+// 滚动文件名为 <base>_<时间>-<编号>.log，按编号排序
+static std::vector<std::string> logFiles(const Options &options, const std::string &runDir)
+{
+    std::vector<std::string> files;
+    if (options.sink_ == "file")
+    {
+        files.push_back(runDir + "/soak.log");
+        return files;
+    }
+#ifndef _WIN32
+    std::vector<std::pair<size_t, std::string>> rolled;
+    DIR *dir = opendir(runDir.c_str());
+    if (dir == nullptr)
+        return files;
+    while (struct dirent *entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        size_t dash = name.rfind('-');
+        if (name.compare(0, 5, "roll_") != 0 || dash == std::string::npos)
+            continue;
+        rolled.push_back({std::stoul(name.substr(dash + 1)), runDir + "/" + name});
+    }
+    closedir(dir);
+    std::sort(rolled.begin(), rolled.end());
+    for (auto &file : rolled)
+        files.push_back(file.second);
+#endif
+    return files;
+}
+
+// 逐线程校验序号，produced为各线程写入的记录数
+static bool verify(const std::vector<std::string> &files, const std::vector<uint64_t> &produced)
+{
+    std::vector<uint64_t> expected(produced.size(), 0);
+    uint64_t lost = 0, duplicated = 0, malformed = 0, lines = 0;
+    for (auto &path : files)
+    {
+        std::ifstream ifs(path, std::ios::binary);
+        if (!ifs.is_open())
+        {
+            std::cerr << "无法打开日志文件: " << path << std::endl;
+            return false;
+        }
+        std::string line;
+        while (std::getline(ifs, line))
+        {
+            lines++;
+            char *end = nullptr;
+            unsigned long thread = strtoul(line.c_str(), &end, 10);
+            if (end == line.c_str() || *end != ' ' || thread >= produced.size())
+            {
+                malformed++;
+                continue;
+            }
+            uint64_t seq = strtoull(end + 1, nullptr, 10);
+            uint64_t &next = expected[thread];
+            if (seq == next)
+                next++;
+            else if (seq > next)
+            {
+                if (lost < 10)
+                    std::cerr << "线程" << thread << "缺少序号 [" << next << ", " << seq << ")" << std::endl;
+                lost += seq - next;
+                next = seq + 1;
+            }
+            else
+            {
+                if (duplicated < 10)
+                    std::cerr << "线程" << thread << "序号" << seq << "重复或乱序，期望" << next << std::endl;
+                duplicated++;
+            }
+        }
+    }
+    for (size_t i = 0; i < produced.size(); ++i)
+    {
+        if (expected[i] < produced[i])
+        {
+            std::cerr << "线程" << i << "末尾缺少" << produced[i] - expected[i] << "条记录" << std::endl;
+            lost += produced[i] - expected[i];
+        }
+    }
+    std::cout << fmt::format("校验: {}个文件 {}行 丢失{} 重复/乱序{} 格式错误{}\n", files.size(), lines, lost, duplicated, malformed);
+    return lost == 0 && duplicated == 0 && malformed == 0;
+}
+
+static void report(const std::vector<Sample> &samples)
+{
+    if (samples.empty())
+        return;
+    double sum = 0, minRate = samples[0].rate_, maxRate = samples[0].rate_;
+    size_t peak = 0;
+    for (auto &sample : samples)
+    {
+        sum += sample.rate_;
+        minRate = std::min(minRate, sample.rate_);
+        maxRate = std::max(maxRate, sample.rate_);
+        peak = std::max(peak, sample.rss_);
+    }
+    double mean = sum / samples.size();
+    double var = 0;
+    for (auto &sample : samples)
+        var += (sample.rate_ - mean) * (sample.rate_ - mean);
+    double cv = mean > 0 ? std::sqrt(var / samples.size()) / mean : 0;
+    // 漂移：最后一个区间相对第一个区间的变化
+    double drift = samples.front().rate_ > 0 ? (samples.back().rate_ / samples.front().rate_ - 1) * 100 : 0;
+    std::cout << fmt::format("吞吐: 平均{:.0f}/s 最小{:.0f}/s 最大{:.0f}/s 变异系数{:.3f} 首末漂移{:+.1f}%\n", mean, minRate, maxRate, cv, drift);
+    std::cout << fmt::format("RSS: 开始{:.1f}MB 峰值{:.1f}MB 结束{:.1f}MB\n", samples.front().rss_ / 1048576.0,
+                             peak / 1048576.0, samples.back().rss_ / 1048576.0);
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--type")
+            options.type_ = value;
+        else if (key == "--threads")
+            options.threads_ = std::stoul(value);
+        else if (key == "--seconds")
+            options.seconds_ = std::stoul(value);
+        else if (key == "--size")
+            options.size_ = std::stoul(value);
+        else if (key == "--interval")
+            options.interval_ = std::max<size_t>(1, std::stoul(value));
+        else if (key == "--rate")
+            options.rate_ = std::stoul(value);
+        else if (key == "--sink")
+            options.sink_ = value;
+        else if (key == "--dir")
+            options.dir_ = value;
+        else if (key == "--numa")
+            options.numa_ = value != "0";
+        else if (key == "--stage")
+            options.stage_ = std::stoul(value);
+        else
+        {
+            std::cout << "用法: " << argv[0] << " [--type safe|unsafe] [--threads n] [--seconds n] [--size n]"
+                      << " [--interval n] [--rate n] [--sink file|roll] [--dir path] [--numa 0|1] [--stage n]" << std::endl;
+            return -1;
+        }
+    }
+    if (options.sink_ != "file" && options.sink_ != "roll")
+    {
+        std::cerr << "未知的落地方向: " << options.sink_ << std::endl;
+        return -1;
+    }
+
+    // 每次运行使用独立目录，避免与上次的文件混在一起
+    std::string runDir = fmt::format("{}/run-{}-{}", options.dir_, time(nullptr), getpid());
+    zlog::File::createDirectory(runDir);
+
+    zlog::LocalLoggerBuilder builder;
+    builder.buildLoggerName("soak");
+    builder.buildLoggerFormatter("%m%n");
+    builder.buildLoggerType(zlog::LoggerType::LOGGER_ASYNC);
+    if (options.type_ == "unsafe")
+        builder.buildEnalleUnSafe();
+    builder.buildNumaSharding(options.numa_);
+    if (options.stage_ != 0)
+        builder.buildWriteCombining(options.stage_);
+    if (options.sink_ == "file")
+        builder.buildLoggerSink<zlog::FileSink>(runDir + "/soak.log");
+    else
+        builder.buildLoggerSink<zlog::RollBySizeSink>(runDir + "/roll", 64 * 1024 * 1024);
+    zlog::Logger::ptr logger = builder.build();
+
+    std::cout << fmt::format("浸泡测试: {} 线程{} 时长{}s 记录{}B 限速{} 分片{} 暂存{}B 目录{}\n", options.type_, options.threads_,
+                             options.seconds_, options.size_, options.rate_, options.numa_, options.stage_, runDir);
+
+    std::atomic<bool> stop(false);
+    std::vector<std::atomic<uint64_t>> produced(options.threads_);
+    for (auto &count : produced)
+        count.store(0);
+    std::string padding(options.size_, 'x');
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < options.threads_; ++i)
+    {
+        threads.emplace_back([&, i]()
+                             {
+            auto begin = std::chrono::steady_clock::now();
+            uint64_t seq = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                logger->ZLOG_INFO("{} {} {}", i, seq, padding);
+                produced[i].store(++seq, std::memory_order_relaxed);
+                // 限速：超前于计划时休眠
+                if (options.rate_ != 0 && seq % 64 == 0)
+                {
+                    auto due = begin + std::chrono::microseconds(seq * 1000000 / options.rate_);
+                    std::this_thread::sleep_until(due);
+                }
+            } });
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto begin = Clock::now();
+    auto deadline = begin + std::chrono::seconds(options.seconds_);
+    std::vector<Sample> samples;
+    uint64_t lastTotal = 0;
+    auto last = begin;
+    std::cout << fmt::format("{:>10} {:>14} {:>10} {:>14}\n", "elapsed", "records/s", "rss(MB)", "pending(B)");
+    while (Clock::now() < deadline)
+    {
+        std::this_thread::sleep_until(std::min(deadline, last + std::chrono::seconds(options.interval_)));
+        auto now = Clock::now();
+        uint64_t total = 0;
+        for (auto &count : produced)
+            total += count.load(std::memory_order_relaxed);
+        zlog::LoggerSnapshot snap = logger->snapshot();
+        Sample sample;
+        sample.elapsed_ = std::chrono::duration<double>(now - begin).count();
+        sample.rate_ = (total - lastTotal) / std::chrono::duration<double>(now - last).count();
+        sample.rss_ = residentBytes();
+        for (auto &looper : snap.loopers_)
+            sample.pending_ += looper.pendingBytes_;
+        samples.push_back(sample);
+        std::cout << fmt::format("{:>9.0f}s {:>14.0f} {:>10.1f} {:>14}\n", sample.elapsed_, sample.rate_,
+                                 sample.rss_ / 1048576.0, sample.pending_)
+                  << std::flush;
+        lastTotal = total;
+        last = now;
+    }
+    stop = true;
+    for (auto &thread : threads)
+        thread.join();
+    logger->flush(true).wait();
+    logger.reset();
+
+    report(samples);
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    for (auto &count : produced)
+    {
+        counts.push_back(count.load());
+        total += counts.back();
+    }
+    std::cout << fmt::format("写入: {}条\n", total);
+    return verify(logFiles(options, runDir), counts) ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+#include "../zlog/collector.hpp"
+#include <csignal>
+#include <iostream>
+
+/*
+    多进程日志收集进程
+        用法: zlog-collector [--shm 目录] [--uds 套接字路径] [--out 日志文件] [--roll 单个文件字节数]
+        --shm 监视共享内存环目录(客户端使用ShmRingSink)，--uds 接收数据报(客户端使用UdsSink)，至少指定一个
+        未指定--out时写到标准输出；收到SIGINT/SIGTERM后读空所有来源再退出
+*/
+static std::atomic<bool> g_stop(false);
+
+static void onSignal(int)
+{
+    g_stop.store(true);
+}
+
+int main(int argc, char *argv[])
+{
+    std::string shmDir, udsPath, out;
+    size_t roll = 0;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--shm")
+            shmDir = value;
+        else if (key == "--uds")
+            udsPath = value;
+        else if (key == "--out")
+            out = value;
+        else if (key == "--roll")
+            roll = std::stoul(value);
+        else
+        {
+            shmDir.clear();
+            udsPath.clear();
+            break;
+        }
+    }
+    if ((shmDir.empty() && udsPath.empty()) || argc % 2 == 0)
+    {
+        std::cerr << "用法: " << argv[0] << " [--shm 目录] [--uds 套接字路径] [--out 日志文件] [--roll 单个文件字节数]" << std::endl;
+        return 2;
+    }
+
+    std::vector<zlog::LogSink::ptr> sinks;
+    if (out.empty())
+        sinks.push_back(std::make_shared<zlog::StdOutSink>());
+    else if (roll > 0)
+        sinks.push_back(std::make_shared<zlog::RollBySizeSink>(out, roll));
+    else
+        sinks.push_back(std::make_shared<zlog::AppendFileSink>(out));
+
+    zlog::LogCollector collector(sinks);
+    if (!shmDir.empty())
+        collector.watchShm(shmDir);
+    if (!udsPath.empty() && !collector.listenUds(udsPath))
+        return 1;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    collector.run(g_stop);
+    std::cerr << "收集" << collector.bytes() << "字节，客户端丢弃" << collector.dropped() << "条记录" << std::endl;
+    return 0;
+}
@@ -0,0 +1,288 @@
+#include "../zlog/index.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+    按时间范围查询日志文件
+        用法: zlog-query [--from 时间] [--to 时间] [--level 等级] [--threads n] [--count] [--pattern 子串] 日志文件...
+        1. 映射日志文件；存在<日志文件>.idx时只扫描与时间范围重叠、且包含不低于指定等级记录的段，以及未索引的尾部
+        2. 扫描范围按行边界切分给多个线程，以SIMD比较子串首尾字符筛选候选位置
+        3. 匹配的行按文件内顺序输出；--count只输出匹配行数
+    时间为"YYYY-mm-dd HH:MM:SS"(本地时间)或Unix秒；时间与等级的精度为索引段，段内不再逐行过滤
+*/
+
+struct Range
+{
+    size_t begin_;
+    size_t end_;
+};
+
+struct Query
+{
+    int64_t from_ = INT64_MIN; // 毫秒
+    int64_t to_ = INT64_MAX;
+    uint32_t levels_ = zlog::TimeIndex::ALL_LEVELS; // 需要的等级
+    std::string pattern_;
+    size_t threads_ = std::max(1u, std::thread::hardware_concurrency());
+    bool count_ = false;
+};
+
+// 时间精度为秒，upper为真时取该秒的最后一毫秒，使--to包含整秒
+static bool parseTime(const std::string &text, int64_t &ms, bool upper)
+{
+    int64_t extra = upper ? 999 : 0;
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char *end = strptime(text.c_str(), "%Y-%m-%d %H:%M:%S", &tm);
+    if (end != nullptr && *end == '\0')
+    {
+        tm.tm_isdst = -1;
+        ms = static_cast<int64_t>(mktime(&tm)) * 1000 + extra;
+        return true;
+    }
+    char *stop = nullptr;
+    long long seconds = strtoll(text.c_str(), &stop, 10);
+    if (stop == text.c_str() || *stop != '\0')
+        return false;
+    ms = seconds * 1000 + extra;
+    return true;
+}
+
+static bool parseLevel(const std::string &text, uint32_t &levels)
+{
+    for (int v = static_cast<int>(zlog::LogLevel::value::DEBUG); v <= static_cast<int>(zlog::LogLevel::value::FATAL); ++v)
+    {
+        zlog::LogLevel::value level = static_cast<zlog::LogLevel::value>(v);
+        if (text == zlog::LogLevel::toString(level))
+        {
+            // 不低于该等级的所有等级
+            levels = ~(zlog::TimeIndex::levelBit(level) - 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+// 在[begin, end)中查找needle，返回首个匹配位置或nullptr
+static const char *search(const char *begin, const char *end, const std::string &needle)
+{
+    size_t m = needle.size();
+    if (m == 0)
+        return begin;
+    if (static_cast<size_t>(end - begin) < m)
+        return nullptr;
+    const char *last = end - m; // 最后一个可能的起点
+    const char *p = begin;
+#ifdef __SSE2__
+    // 一次比较16个起点的首字符与尾字符，二者都相等的位置再逐字节确认
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i tail = _mm_set1_epi8(needle[m - 1]);
+    while (p + 16 <= last + 1)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + m - 1));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, tail))));
+        while (mask != 0)
+        {
+            int bit = __builtin_ctz(mask);
+            if (m <= 2 || memcmp(p + bit + 1, needle.data() + 1, m - 2) == 0)
+                return p + bit;
+            mask &= mask - 1;
+        }
+        p += 16;
+    }
+#endif
+    for (; p <= last; ++p)
+        if (*p == needle[0] && memcmp(p, needle.data(), m) == 0)
+            return p;
+    return nullptr;
+}
+
+// 在一个范围内收集匹配行的[起点, 终点)
+static void scan(const char *base, Range range, const std::string &pattern, std::vector<Range> &matches)
+{
+    const char *p = base + range.begin_;
+    const char *end = base + range.end_;
+    while (p < end)
+    {
+        const char *hit = search(p, end, pattern);
+        if (hit == nullptr)
+            return;
+        const char *lineBegin = hit;
+        while (lineBegin > p && lineBegin[-1] != '\n')
+            --lineBegin;
+        const char *lineEnd = static_cast<const char *>(memchr(hit, '\n', static_cast<size_t>(end - hit)));
+        lineEnd = lineEnd == nullptr ? end : lineEnd + 1;
+        matches.push_back({static_cast<size_t>(lineBegin - base), static_cast<size_t>(lineEnd - base)});
+        p = lineEnd;
+    }
+}
+
+// 根据索引得到需要扫描的范围；没有索引时为整个文件
+static std::vector<Range> plan(const std::string &path, size_t size, const Query &query)
+{
+    std::vector<Range> ranges;
+    std::vector<zlog::IndexEntry> entries;
+    if (!zlog::TimeIndex::load(path, entries))
+    {
+        ranges.push_back({0, size});
+        return ranges;
+    }
+    // 段按时间递增写入，二分找到第一个可能重叠的段
+    auto it = std::lower_bound(entries.begin(), entries.end(), query.from_, [](const zlog::IndexEntry &entry, int64_t from)
+                               { return entry.last_ < from; });
+    uint64_t indexed = 0;
+    for (auto &entry : entries)
+        indexed = std::max<uint64_t>(indexed, entry.offset_ + entry.length_);
+    for (; it != entries.end() && it->first_ <= query.to_; ++it)
+    {
+        if ((it->levels_ & query.levels_) == 0 || it->offset_ >= size)
+            continue;
+        size_t begin = static_cast<size_t>(it->offset_);
+        size_t end = static_cast<size_t>(std::min<uint64_t>(it->offset_ + it->length_, size));
+        if (!ranges.empty() && ranges.back().end_ == begin)
+            ranges.back().end_ = end;
+        else
+            ranges.push_back({begin, end});
+    }
+    // 最后一段尚未写入索引(写入中或进程崩溃)，尾部总是扫描
+    if (indexed < size)
+        ranges.push_back({static_cast<size_t>(indexed), size});
+    return ranges;
+}
+
+// 将扫描范围按行边界切成约threads份
+static std::vector<Range> split(const char *base, const std::vector<Range> &ranges, size_t threads)
+{
+    size_t total = 0;
+    for (auto &range : ranges)
+        total += range.end_ - range.begin_;
+    size_t chunk = std::max<size_t>(total / threads + 1, 1024 * 1024);
+    std::vector<Range> chunks;
+    for (auto &range : ranges)
+    {
+        size_t begin = range.begin_;
+        while (begin < range.end_)
+        {
+            size_t end = std::min(range.end_, begin + chunk);
+            if (end < range.end_)
+            {
+                const char *nl = static_cast<const char *>(memchr(base + end, '\n', range.end_ - end));
+                end = nl == nullptr ? range.end_ : static_cast<size_t>(nl - base) + 1;
+            }
+            chunks.push_back({begin, end});
+            begin = end;
+        }
+    }
+    return chunks;
+}
+
+static bool queryFile(const std::string &path, const Query &query, size_t &total)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        std::cerr << "打开日志文件失败: " << path << " " << strerror(errno) << std::endl;
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size == 0)
+    {
+        close(fd);
+        return true;
+    }
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        std::cerr << "映射日志文件失败: " << path << " " << strerror(errno) << std::endl;
+        return false;
+    }
+    const char *base = static_cast<const char *>(map);
+    madvise(map, size, MADV_SEQUENTIAL);
+    std::vector<Range> chunks = split(base, plan(path, size, query), query.threads_);
+
+    // 各线程按块轮流领取，结果按块顺序输出
+    std::vector<std::vector<Range>> matches(chunks.size());
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < std::min(query.threads_, chunks.size()); ++t)
+    {
+        workers.emplace_back([&]()
+                             {
+            size_t i;
+            while ((i = next.fetch_add(1)) < chunks.size())
+                scan(base, chunks[i], query.pattern_, matches[i]); });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    for (auto &chunk : matches)
+    {
+        total += chunk.size();
+        if (query.count_)
+            continue;
+        for (auto &line : chunk)
+            fwrite(base + line.begin_, 1, line.end_ - line.begin_, stdout);
+    }
+    munmap(map, size);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    Query query;
+    std::vector<std::string> files;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--from" && hasValue)
+            valid = parseTime(argv[++i], query.from_, false);
+        else if (arg == "--to" && hasValue)
+            valid = parseTime(argv[++i], query.to_, true);
+        else if (arg == "--level" && hasValue)
+            valid = parseLevel(argv[++i], query.levels_);
+        else if (arg == "--threads" && hasValue)
+            query.threads_ = std::max(1ul, std::stoul(argv[++i]));
+        else if (arg == "--pattern" && hasValue)
+            query.pattern_ = argv[++i];
+        else if (arg == "--count")
+            query.count_ = true;
+        else
+            files.push_back(arg);
+    }
+    if (!valid || files.empty())
+    {
+        std::cerr << "用法: " << argv[0] << " [--from 时间] [--to 时间] [--level 等级] [--threads n] [--count] [--pattern 子串] 日志文件..." << std::endl;
+        std::cerr << "时间为\"YYYY-mm-dd HH:MM:SS\"或Unix秒，等级为DEBUG/INFO/WARNING/ERROR/FATAL" << std::endl;
+        return 2;
+    }
+
+    size_t total = 0;
+    bool ok = true;
+    for (auto &file : files)
+        ok = queryFile(file, query, total) && ok;
+    if (query.count_)
+        std::cout << total << std::endl;
+    else
+        fflush(stdout);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+#include "../zlog/ring.hpp"
+#include <cstdio>
+#include <iostream>
+
+/*
+    从飞行记录文件中恢复进程崩溃时尚未落地的日志
+        用法: zlog-recover <飞行记录文件> [输出文件]
+        未指定输出文件时写到标准输出；指定时追加到文件末尾，可直接追加回原日志文件
+*/
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        std::cerr << "用法: " << argv[0] << " <飞行记录文件> [输出文件]" << std::endl;
+        return 2;
+    }
+
+    FILE *out = stdout;
+    if (argc == 3)
+    {
+        out = fopen(argv[2], "ab");
+        if (out == nullptr)
+        {
+            std::cerr << "打开输出文件失败: " << argv[2] << std::endl;
+            return 1;
+        }
+    }
+
+    std::string err;
+    long long bytes = zlog::MmapRing::recover(argv[1], out, err);
+    if (out != stdout)
+        fclose(out);
+    else
+        fflush(out);
+    if (bytes < 0)
+    {
+        std::cerr << "恢复失败: " << argv[1] << " " << err << std::endl;
+        return 1;
+    }
+    std::cerr << "恢复" << bytes << "字节" << std::endl;
+    return 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <fmt/format.h>
+
+/*
+    回溯环：保存最近一段低于日志器等级的已格式化记录
+        1. 固定大小的环形字节区，每条记录前附4字节长度，空间不足时覆盖最旧的记录
+        2. 写入只有一次加锁与内存拷贝，不落地
+        3. 触发等级的记录出现时，按写入顺序取出全部记录，先于触发记录落地
+*/
+namespace zlog
+{
+    class Backtrace
+    {
+    public:
+        using ptr = std::unique_ptr<Backtrace>;
+
+        explicit Backtrace(size_t capacity)
+            : buffer_(capacity), head_(0), tail_(0)
+        {
+        }
+
+        // 保存一条记录；超过容量的记录不保存
+        void push(const char *data, size_t len)
+        {
+            size_t need = len + sizeof(uint32_t);
+            if (need > buffer_.size())
+                return;
+            std::unique_lock<std::mutex> lock(mutex_);
+            // 覆盖最旧的记录直到空间足够
+            while (tail_ - head_ + need > buffer_.size())
+                head_ += sizeof(uint32_t) + frameLength(head_);
+            uint32_t len32 = static_cast<uint32_t>(len);
+            copyIn(tail_, reinterpret_cast<const char *>(&len32), sizeof(len32));
+            copyIn(tail_ + sizeof(len32), data, len);
+            tail_ += need;
+        }
+
+        // 按写入顺序取出全部记录追加到out，并清空回溯环
+        void take(fmt::memory_buffer &out)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (head_ < tail_)
+            {
+                uint32_t len = frameLength(head_);
+                size_t begin = out.size();
+                out.resize(begin + len);
+                copyOut(head_ + sizeof(uint32_t), out.data() + begin, len);
+                head_ += sizeof(uint32_t) + len;
+            }
+            head_ = tail_ = 0;
+        }
+
+    private:
+        uint32_t frameLength(uint64_t pos) const
+        {
+            uint32_t len;
+            copyOut(pos, reinterpret_cast<char *>(&len), sizeof(len));
+            return len;
+        }
+
+        // 以单调位置读写，跨越末尾时分两段拷贝
+        void copyIn(uint64_t pos, const char *data, size_t len)
+        {
+            size_t offset = static_cast<size_t>(pos % buffer_.size());
+            size_t first = std::min(len, buffer_.size() - offset);
+            memcpy(buffer_.data() + offset, data, first);
+            memcpy(buffer_.data(), data + first, len - first);
+        }
+
+        void copyOut(uint64_t pos, char *data, size_t len) const
+        {
+            size_t offset = static_cast<size_t>(pos % buffer_.size());
+            size_t first = std::min(len, buffer_.size() - offset);
+            memcpy(data, buffer_.data() + offset, first);
+            memcpy(data + first, buffer_.data(), len - first);
+        }
+
+    private:
+        std::mutex mutex_;
+        std::vector<char> buffer_;
+        uint64_t head_; // 最旧记录的位置
+        uint64_t tail_; // 下一条记录的写入位置
+    };
+};
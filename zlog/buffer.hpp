@@ -11,11 +11,19 @@ namespace zlog
     class Buffer
     {
     public:
-        Buffer()
-            : buffer_(DEFAULT_BUFFER_SIZE), writerIdx_(0), readerIdx_(0)
+        Buffer(size_t size = DEFAULT_BUFFER_SIZE)
+            : buffer_(size), writerIdx_(0), readerIdx_(0), node_(-1)
         {
         }
 
+        // 将缓冲区内存放置到指定NUMA节点，扩容后重新绑定
+        void bindNode(int node)
+        {
+            node_ = node;
+            if (node_ >= 0 && !buffer_.empty())
+                Numa::bind(buffer_.data(), buffer_.size(), node_);
+        }
+
         // 向缓冲区写入数据
         void push(const char *data, size_t len)
         {
@@ -55,6 +63,21 @@ namespace zlog
             readerIdx_ += len;
         }
 
+        // 分段读取：可读数据暂时缩短为前len字节，返回被隐藏的字节数，之后用extendReadable恢复
+        size_t shrinkReadable(size_t len)
+        {
+            assert(len <= readAbleSize());
+            size_t hidden = readAbleSize() - len;
+            writerIdx_ -= hidden;
+            return hidden;
+        }
+
+        void extendReadable(size_t hidden)
+        {
+            assert(hidden <= writeAbleSize());
+            writerIdx_ += hidden;
+        }
+
         // 重置读写位置，初始化缓冲区
         void reset()
         {
@@ -67,6 +90,13 @@ namespace zlog
             buffer_.swap(buffer.buffer_);
             std::swap(readerIdx_, buffer.readerIdx_);
             std::swap(writerIdx_, buffer.writerIdx_);
+            std::swap(node_, buffer.node_);
+        }
+
+        // 当前容量
+        size_t capacity() const
+        {
+            return buffer_.size();
         }
 
         // 判断缓冲区是否为空
@@ -94,6 +124,8 @@ namespace zlog
             }
 
             buffer_.resize(newSize);
+            if (node_ >= 0)
+                Numa::bind(buffer_.data(), buffer_.size(), node_);
         }
         
         // 移动写下标
@@ -107,5 +139,6 @@ namespace zlog
         std::vector<char> buffer_; // 缓冲区
         size_t writerIdx_;         // 当前可写数据的下标
         size_t readerIdx_;         // 当前可读数据的下标
+        int node_;                 // 绑定的NUMA节点，-1表示不绑定
     };
 };
\ No newline at end of file
@@ -0,0 +1,280 @@
+#pragma once
+#include "transport.hpp"
+#include <map>
+#include <vector>
+#include <fstream>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <poll.h>
+#endif
+
+/*
+    多进程日志收集
+        1. 监视共享内存环目录，映射新出现的<pid>.ring，轮流读取完整记录；
+           写入进程关闭或退出且环已读空时删除环文件
+        2. 在Unix域数据报套接字上以recvmmsg批量接收
+        3. 一轮读取的所有记录合并为一次写入真正的落地方向；记录在客户端已格式化，这里不再处理
+    由zlog-collector使用，也可嵌入到任意进程中
+*/
+namespace zlog
+{
+#ifndef _WIN32
+    class LogCollector
+    {
+    public:
+        static constexpr size_t BATCH_BYTES = 1024 * 1024; // 每轮每个来源最多读取的数据量
+        static constexpr size_t RECV_BATCH = 32;           // 每次recvmmsg的数据报数
+
+        explicit LogCollector(const std::vector<LogSink::ptr> &sinks)
+            : sinks_(sinks), retiredDrops_(0), udsFd_(-1), bytes_(0)
+        {
+        }
+
+        ~LogCollector()
+        {
+            if (udsFd_ >= 0)
+            {
+                ::close(udsFd_);
+                unlink(udsPath_.c_str());
+            }
+            if (!shmDir_.empty())
+                unlink(ShmRing::collectorPidFile(shmDir_).c_str());
+        }
+
+        LogCollector(const LogCollector &) = delete;
+        LogCollector &operator=(const LogCollector &) = delete;
+
+        // 监视共享内存环目录
+        void watchShm(const std::string &dir)
+        {
+            File::createDirectory(dir);
+            shmDir_ = dir;
+            std::ofstream pidFile(ShmRing::collectorPidFile(dir), std::ios::trunc);
+            pidFile << getpid() << std::endl;
+            scan();
+        }
+
+        // 在path上接收数据报
+        bool listenUds(const std::string &path)
+        {
+            struct sockaddr_un addr;
+            if (path.size() >= sizeof(addr.sun_path))
+            {
+                std::cerr << "套接字路径过长: " << path << std::endl;
+                return false;
+            }
+            File::createDirectory(File::path(path));
+            unlink(path.c_str());
+            udsFd_ = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+            if (udsFd_ < 0 || bind(udsFd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0)
+            {
+                std::cerr << "监听套接字失败: " << path << " " << strerror(errno) << std::endl;
+                if (udsFd_ >= 0)
+                    ::close(udsFd_);
+                udsFd_ = -1;
+                return false;
+            }
+            udsPath_ = path;
+            recvBuffers_.assign(RECV_BATCH, std::vector<char>(UdsSink::MAX_DATAGRAM));
+            return true;
+        }
+
+        /*
+            收集一轮并写入落地方向，返回写入的字节数
+                没有数据时最多等待wait(有套接字时可被新数据报提前唤醒)
+        */
+        size_t pollOnce(std::chrono::milliseconds wait)
+        {
+            batch_.clear();
+            auto now = std::chrono::steady_clock::now();
+            if (!shmDir_.empty() && now - lastScan_ >= std::chrono::milliseconds(200))
+            {
+                scan();
+                lastScan_ = now;
+            }
+
+            for (auto &entry : rings_)
+            {
+                entry.second->beat();
+                entry.second->read(batch_, BATCH_BYTES);
+            }
+            receive();
+
+            if (batch_.empty())
+            {
+                if (udsFd_ >= 0)
+                {
+                    struct pollfd pfd;
+                    pfd.fd = udsFd_;
+                    pfd.events = POLLIN;
+                    ::poll(&pfd, 1, static_cast<int>(wait.count()));
+                }
+                else
+                    std::this_thread::sleep_for(wait);
+                return 0;
+            }
+
+            size_t bytes = batch_.size();
+            flushBatch();
+            return bytes;
+        }
+
+        // 循环收集直到stop为真，退出前读空所有来源
+        void run(const std::atomic<bool> &stop, std::chrono::milliseconds idle = std::chrono::milliseconds(1))
+        {
+            while (!stop.load(std::memory_order_relaxed))
+                pollOnce(idle);
+            while (pollOnce(std::chrono::milliseconds(0)) > 0)
+                ;
+            for (auto &sink : sinks_)
+                sink->flush();
+        }
+
+        // 已映射的环数量
+        size_t rings() const
+        {
+            return rings_.size();
+        }
+
+        // 所有环累计丢弃的记录数
+        uint64_t dropped() const
+        {
+            uint64_t total = retiredDrops_;
+            for (auto &entry : rings_)
+                total += entry.second->dropped();
+            return total;
+        }
+
+        uint64_t bytes() const
+        {
+            return bytes_;
+        }
+
+    private:
+        // 发现新环，回收写入进程已关闭或退出且已读空的环
+        void scan()
+        {
+            DIR *dir = opendir(shmDir_.c_str());
+            if (dir == nullptr)
+                return;
+            std::map<std::string, uint64_t> present;
+            while (struct dirent *entry = readdir(dir))
+            {
+                std::string name = entry->d_name;
+                if (name.size() <= 5 || name.compare(name.size() - 5, 5, ".ring") != 0)
+                    continue;
+                std::string path = shmDir_ + "/" + name;
+                struct stat st;
+                if (stat(path.c_str(), &st) == 0)
+                    present[path] = static_cast<uint64_t>(st.st_ino);
+            }
+            closedir(dir);
+
+            for (auto &file : present)
+            {
+                auto it = rings_.find(file.first);
+                // 进程号复用时同名文件被替换，旧环读空后换成新环
+                if (it != rings_.end() && it->second->inode() != file.second)
+                {
+                    it->second->read(batch_, SIZE_MAX);
+                    flushBatch();
+                    retire(it);
+                    it = rings_.end();
+                }
+                if (it == rings_.end())
+                {
+                    ShmRing::ptr ring = ShmRing::open(file.first);
+                    if (ring)
+                        rings_[file.first] = ring;
+                }
+            }
+
+            for (auto it = rings_.begin(); it != rings_.end();)
+            {
+                ShmRing::ptr ring = it->second;
+                bool gone = ring->closed() || (kill(static_cast<pid_t>(ring->pid()), 0) != 0 && errno == ESRCH);
+                if (!gone || !ring->empty())
+                {
+                    ++it;
+                    continue;
+                }
+                // 文件仍是这个环时才删除，避免删掉复用进程号的新环
+                auto file = present.find(it->first);
+                if (file != present.end() && file->second == ring->inode())
+                    unlink(it->first.c_str());
+                it = retire(it);
+            }
+        }
+
+        std::map<std::string, ShmRing::ptr>::iterator retire(std::map<std::string, ShmRing::ptr>::iterator it)
+        {
+            retiredDrops_ += it->second->dropped();
+            return rings_.erase(it);
+        }
+
+        void flushBatch()
+        {
+            if (batch_.empty())
+                return;
+            for (auto &sink : sinks_)
+                sink->emit(batch_.data(), batch_.size());
+            bytes_ += batch_.size();
+            batch_.clear();
+        }
+
+        // 非阻塞地读取套接字中已到达的数据报
+        void receive()
+        {
+            if (udsFd_ < 0)
+                return;
+            size_t received = 0;
+            while (received < BATCH_BYTES)
+            {
+                struct iovec iov[RECV_BATCH];
+#ifdef __linux__
+                struct mmsghdr msgs[RECV_BATCH];
+                memset(msgs, 0, sizeof(msgs));
+                for (size_t i = 0; i < RECV_BATCH; ++i)
+                {
+                    iov[i].iov_base = recvBuffers_[i].data();
+                    iov[i].iov_len = recvBuffers_[i].size();
+                    msgs[i].msg_hdr.msg_iov = &iov[i];
+                    msgs[i].msg_hdr.msg_iovlen = 1;
+                }
+                int n = recvmmsg(udsFd_, msgs, RECV_BATCH, MSG_DONTWAIT, nullptr);
+                if (n <= 0)
+                    return;
+                for (int i = 0; i < n; ++i)
+                {
+                    batch_.insert(batch_.end(), recvBuffers_[i].data(), recvBuffers_[i].data() + msgs[i].msg_len);
+                    received += msgs[i].msg_len;
+                }
+#else
+                iov[0].iov_base = recvBuffers_[0].data();
+                iov[0].iov_len = recvBuffers_[0].size();
+                ssize_t n = recv(udsFd_, iov[0].iov_base, iov[0].iov_len, MSG_DONTWAIT);
+                if (n <= 0)
+                    return;
+                batch_.insert(batch_.end(), recvBuffers_[0].data(), recvBuffers_[0].data() + n);
+                received += static_cast<size_t>(n);
+#endif
+            }
+        }
+
+        std::vector<LogSink::ptr> sinks_;
+        std::string shmDir_;
+        std::map<std::string, ShmRing::ptr> rings_; // 环文件路径 -> 映射
+        uint64_t retiredDrops_; // 已回收的环累计丢弃的记录数
+        int udsFd_;
+        std::string udsPath_;
+        std::vector<std::vector<char>> recvBuffers_;
+        std::chrono::steady_clock::time_point lastScan_;
+        std::vector<char> batch_;
+        uint64_t bytes_;
+    };
+#endif
+};
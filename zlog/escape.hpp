@@ -0,0 +1,245 @@
+#pragma once
+#include <cstring>
+#include <cstdint>
+#include <fmt/format.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ZLOG_ESCAPE_X86 1
+#endif
+
+/*
+    转义模块
+        1. JSON字符串转义：引号、反斜杠、控制字符与非法UTF-8
+        2. 行清洗：面向按行切分的日志文件，转义控制字符与非法UTF-8
+        3. logfmt取值：必要时加引号并转义
+    扫描使用向量化内核(AVX2/SSE2/标量)，运行时按CPU选择；无需转义的片段整段拷贝
+*/
+namespace zlog
+{
+    class Escape
+    {
+    public:
+        // 扫描内核：返回第一个需要处理的字节下标，不存在返回len
+        // 需要处理的字节：控制字符、非ASCII字节，quotes为真时还包括引号与反斜杠
+        using ScanFunc = size_t (*)(const char *data, size_t len, bool quotes);
+
+        // 写入JSON字符串内容（不含两侧引号）
+        static void json(fmt::memory_buffer &buffer, const char *data, size_t len)
+        {
+            escape(buffer, data, len, true);
+        }
+
+        // 写入带引号的JSON字符串
+        static void jsonQuoted(fmt::memory_buffer &buffer, const char *data, size_t len)
+        {
+            buffer.push_back('"');
+            json(buffer, data, len);
+            buffer.push_back('"');
+        }
+
+        // 清洗单行日志内容：换行等控制字符转义，保证一条记录只占一行
+        static void line(fmt::memory_buffer &buffer, const char *data, size_t len)
+        {
+            escape(buffer, data, len, false);
+        }
+
+        // 写入logfmt取值：包含空格、等号、引号或控制字符时加引号
+        static void logfmt(fmt::memory_buffer &buffer, const char *data, size_t len)
+        {
+            if (len > 0 && !needQuote(data, len))
+            {
+                buffer.append(data, data + len);
+                return;
+            }
+            jsonQuoted(buffer, data, len);
+        }
+
+        // 当前CPU选用的扫描内核
+        static ScanFunc scanner()
+        {
+            static const ScanFunc func = selectScanner();
+            return func;
+        }
+
+        static size_t scanScalar(const char *data, size_t len, bool quotes)
+        {
+            for (size_t i = 0; i < len; ++i)
+            {
+                unsigned char c = static_cast<unsigned char>(data[i]);
+                if (c < 0x20 || c >= 0x80 || (quotes && (c == '"' || c == '\\')))
+                    return i;
+            }
+            return len;
+        }
+
+#ifdef ZLOG_ESCAPE_X86
+        // 有符号比较 v < 0x20 同时覆盖控制字符与最高位为1的非ASCII字节
+        __attribute__((target("sse2"))) static size_t scanSSE2(const char *data, size_t len, bool quotes)
+        {
+            const __m128i space = _mm_set1_epi8(0x20);
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i slash = _mm_set1_epi8('\\');
+            size_t i = 0;
+            for (; i + 16 <= len; i += 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                __m128i hit = _mm_cmplt_epi8(v, space);
+                if (quotes)
+                    hit = _mm_or_si128(hit, _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)));
+                int mask = _mm_movemask_epi8(hit);
+                if (mask != 0)
+                    return i + __builtin_ctz(mask);
+            }
+            return i + scanScalar(data + i, len - i, quotes);
+        }
+
+        __attribute__((target("avx2"))) static size_t scanAVX2(const char *data, size_t len, bool quotes)
+        {
+            const __m256i space = _mm256_set1_epi8(0x20);
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i slash = _mm256_set1_epi8('\\');
+            size_t i = 0;
+            for (; i + 32 <= len; i += 32)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                __m256i hit = _mm256_cmpgt_epi8(space, v);
+                if (quotes)
+                    hit = _mm256_or_si256(hit, _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, slash)));
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+                if (mask != 0)
+                    return i + __builtin_ctz(mask);
+            }
+            return i + scanSSE2(data + i, len - i, quotes);
+        }
+#endif
+
+    private:
+        static ScanFunc selectScanner()
+        {
+#ifdef ZLOG_ESCAPE_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return &scanAVX2;
+            if (__builtin_cpu_supports("sse2"))
+                return &scanSSE2;
+#endif
+            return &scanScalar;
+        }
+
+        static void escape(fmt::memory_buffer &buffer, const char *data, size_t len, bool quotes)
+        {
+            ScanFunc scan = scanner();
+            size_t pos = 0;
+            while (pos < len)
+            {
+                // 1. 无需转义的片段整段拷贝
+                size_t clean = scan(data + pos, len - pos, quotes);
+                buffer.append(data + pos, data + pos + clean);
+                pos += clean;
+                if (pos == len)
+                    break;
+
+                // 2. 合法的UTF-8多字节序列原样保留，非法字节替换为U+FFFD
+                unsigned char c = static_cast<unsigned char>(data[pos]);
+                if (c >= 0x80)
+                {
+                    size_t n = utf8Length(data + pos, len - pos);
+                    if (n > 0)
+                    {
+                        buffer.append(data + pos, data + pos + n);
+                        pos += n;
+                    }
+                    else
+                    {
+                        static const char replacement[] = "\xEF\xBF\xBD";
+                        buffer.append(replacement, replacement + 3);
+                        pos += 1;
+                    }
+                    continue;
+                }
+
+                // 3. 控制字符、引号与反斜杠；行清洗模式下保留引号、反斜杠与制表符
+                if (!quotes && (c >= 0x20 || c == '\t'))
+                    buffer.push_back(static_cast<char>(c));
+                else
+                    escapeByte(buffer, c);
+                pos += 1;
+            }
+        }
+
+        // 校验以data开头的UTF-8序列，合法返回字节数，非法返回0
+        static size_t utf8Length(const char *data, size_t len)
+        {
+            const unsigned char *s = reinterpret_cast<const unsigned char *>(data);
+            size_t n = 0;
+            uint32_t min = 0;
+            uint32_t cp = 0;
+            if (s[0] >= 0xC2 && s[0] <= 0xDF)
+            {
+                n = 2, min = 0x80, cp = s[0] & 0x1F;
+            }
+            else if (s[0] >= 0xE0 && s[0] <= 0xEF)
+            {
+                n = 3, min = 0x800, cp = s[0] & 0x0F;
+            }
+            else if (s[0] >= 0xF0 && s[0] <= 0xF4)
+            {
+                n = 4, min = 0x10000, cp = s[0] & 0x07;
+            }
+            else
+            {
+                return 0;
+            }
+            if (n > len)
+                return 0;
+            for (size_t i = 1; i < n; ++i)
+            {
+                if ((s[i] & 0xC0) != 0x80)
+                    return 0;
+                cp = (cp << 6) | (s[i] & 0x3F);
+            }
+            // 拒绝过长编码、代理区与超出Unicode范围的码点
+            if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+                return 0;
+            return n;
+        }
+
+        static bool needQuote(const char *data, size_t len)
+        {
+            for (size_t i = 0; i < len; ++i)
+            {
+                unsigned char c = static_cast<unsigned char>(data[i]);
+                if (c <= ' ' || c == '=' || c == '"' || c == '\\')
+                    return true;
+            }
+            return false;
+        }
+
+        static void escapeByte(fmt::memory_buffer &buffer, unsigned char c)
+        {
+            static const char hex[] = "0123456789abcdef";
+            char out[6] = {'\\', c == '"' || c == '\\' ? static_cast<char>(c) : 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+            size_t n = 2;
+            switch (c)
+            {
+            case '"':
+            case '\\':
+                break;
+            case '\n':
+                out[1] = 'n';
+                break;
+            case '\r':
+                out[1] = 'r';
+                break;
+            case '\t':
+                out[1] = 't';
+                break;
+            default:
+                n = 6; // \u00XX
+                break;
+            }
+            buffer.append(out, out + n);
+        }
+    };
+};
@@ -1,5 +1,7 @@
 #pragma once
 #include "message.hpp"
+#include "kv.hpp"
+#include "mdc.hpp"
 #include <ctime>
 #include <memory>
 #include <vector>
@@ -19,13 +21,41 @@ namespace zlog
     };
 
     /*派生格式化子类--消息，等级，时间，文件名，行号，线程ID，日志器名，制表符，换行，其他*/
+    // 主体消息--子规则 %m{json} 按JSON字符串转义，%m{line} 清洗为单行，缺省原样拷贝
     class MessageFormatItem : public FormatItem
     {
     public:
+        enum class Mode
+        {
+            RAW,
+            JSON,
+            LINE
+        };
+
+        MessageFormatItem(Mode mode = Mode::RAW)
+            : mode_(mode)
+        {
+        }
+
         void format(fmt::memory_buffer &buffer, const LogMessage &msg) override
         {
-            fmt::format_to(std::back_inserter(buffer), "{}", msg.payload_);
+            switch (mode_)
+            {
+            case Mode::JSON:
+                Escape::json(buffer, msg.payload_, msg.payloadLen_);
+                break;
+            case Mode::LINE:
+                Escape::line(buffer, msg.payload_, msg.payloadLen_);
+                break;
+            case Mode::RAW:
+            default:
+                buffer.append(msg.payload_, msg.payload_ + msg.payloadLen_);
+                break;
+            }
         }
+
+    protected:
+        Mode mode_;
     };
 
     class LevelFormatItem : public FormatItem
@@ -33,8 +63,8 @@ namespace zlog
     public:
         void format(fmt::memory_buffer &buffer, const LogMessage &msg) override
         {
-            std::string levelstr = LogLevel::toString(msg.level_);
-            fmt::format_to(std::back_inserter(buffer), "{}", levelstr);
+            const char *levelstr = LogLevel::toString(msg.level_);
+            buffer.append(levelstr, levelstr + strlen(levelstr));
         }
     };
 
@@ -73,7 +103,7 @@ namespace zlog
                     cached_time = "InvalidTime";
                 }
             }
-            fmt::format_to(std::back_inserter(buffer), "{}", cached_time);
+            buffer.append(cached_time.data(), cached_time.data() + cached_time.size());
         }
 
     protected:
@@ -85,7 +115,7 @@ namespace zlog
     public:
         void format(fmt::memory_buffer &buffer, const LogMessage &msg) override
         {
-            fmt::format_to(std::back_inserter(buffer), "{}", msg.file_);
+            buffer.append(msg.file_, msg.file_ + strlen(msg.file_));
         }
     };
 
@@ -94,38 +124,107 @@ namespace zlog
     public:
         void format(fmt::memory_buffer &buffer, const LogMessage &msg) override
         {
-            fmt::format_to(std::back_inserter(buffer), "{}", msg.line_);
+            fmt::format_int line(msg.line_);
+            buffer.append(line.data(), line.data() + line.size());
         }
     };
 
 
-    thread_local threadId id_cached{};
-    thread_local std::string tidStr;
+    // 线程ID--缺省为std::thread::id，%t{tid} 为内核线程ID，均在线程首次使用时渲染
     class ThreadIdFormatItem : public FormatItem
     {
+    public:
+        ThreadIdFormatItem(bool kernelTid = false)
+            : kernelTid_(kernelTid)
+        {
+        }
+
+        void format(fmt::memory_buffer &buffer, const LogMessage &msg) override
+        {
+            const std::string &str = kernelTid_ ? msg.thread_->tidStr() : msg.thread_->idStr();
+            buffer.append(str.data(), str.data() + str.size());
+        }
+
+    protected:
+        bool kernelTid_;
+    };
+
+    // 线程名称--通过 zlog::setThreadName 设置，未设置时输出内核线程ID
+    class ThreadNameFormatItem : public FormatItem
+    {
+    public:
+        void format(fmt::memory_buffer &buffer, const LogMessage &msg) override
+        {
+            const std::string &str = msg.thread_->name();
+            buffer.append(str.data(), str.data() + str.size());
+        }
+    };
+
+    class LoggerFormatItem : public FormatItem
+    {
     public:
         void format(fmt::memory_buffer &buffer, const LogMessage &msg) override
         {
-            // 当缓存的ID与当前消息ID不同时才更新
-            if(id_cached != msg.tid_)
+            buffer.append(msg.loggerName_, msg.loggerName_ + strlen(msg.loggerName_));
+        }
+    };
+
+    // 结构化字段--JSON对象：{"key":value,...}
+    class JsonFieldsFormatItem : public FormatItem
+    {
+    public:
+        void format(fmt::memory_buffer &buffer, const LogMessage &msg) override
+        {
+            buffer.push_back('{');
+            for (size_t i = 0; i < msg.fieldCount_; ++i)
             {
-                id_cached = msg.tid_;
-                std::stringstream ss;
-                ss << id_cached;
-                tidStr = ss.str();
+                const KvField &field = msg.fields_[i];
+                if (i > 0)
+                    buffer.push_back(',');
+                Escape::jsonQuoted(buffer, field.key_, strlen(field.key_));
+                buffer.push_back(':');
+                field.encode_(buffer, field.value_, KvEncoding::JSON);
             }
+            buffer.push_back('}');
+        }
+    };
 
-            fmt::format_to(std::back_inserter(buffer), "{}", tidStr);
+    // 结构化字段--logfmt：key=value key=value
+    class LogfmtFieldsFormatItem : public FormatItem
+    {
+    public:
+        void format(fmt::memory_buffer &buffer, const LogMessage &msg) override
+        {
+            for (size_t i = 0; i < msg.fieldCount_; ++i)
+            {
+                const KvField &field = msg.fields_[i];
+                if (i > 0)
+                    buffer.push_back(' ');
+                Escape::logfmt(buffer, field.key_, strlen(field.key_));
+                buffer.push_back('=');
+                field.encode_(buffer, field.value_, KvEncoding::LOGFMT);
+            }
         }
     };
 
-    class LoggerFormatItem : public FormatItem
+    // 诊断上下文--无子规则输出全部字段，%X{key} 输出单个字段取值
+    class MdcFormatItem : public FormatItem
     {
     public:
+        MdcFormatItem(const std::string &key = "")
+            : key_(key)
+        {
+        }
+
         void format(fmt::memory_buffer &buffer, const LogMessage &msg) override
         {
-            fmt::format_to(std::back_inserter(buffer), "{}", msg.loggerName_);
+            const std::string *str = key_.empty() ? &MDC::rendered() : MDC::get(key_.c_str());
+            if (str != nullptr)
+                buffer.append(str->data(), str->data() + str->size());
         }
+
+    protected:
+        std::string key_;
     };
 
     class TabFormatItem : public FormatItem
@@ -133,7 +232,7 @@ namespace zlog
     public:
         void format(fmt::memory_buffer &buffer, const LogMessage &msg) override
         {
-            fmt::format_to(std::back_inserter(buffer), "{}", "\t");
+            buffer.push_back('\t');
         }
     };
 
@@ -142,7 +241,7 @@ namespace zlog
     public:
         void format(fmt::memory_buffer &buffer, const LogMessage &msg) override
         {
-            fmt::format_to(std::back_inserter(buffer), "{}", "\n");
+            buffer.push_back('\n');
         }
     };
 
@@ -155,7 +254,7 @@ namespace zlog
         }
         void format(fmt::memory_buffer &buffer, const LogMessage &msg) override
         {
-            fmt::format_to(std::back_inserter(buffer), "{}", str_);
+            buffer.append(str_.data(), str_.data() + str_.size());
         }
 
     protected:
@@ -164,14 +263,18 @@ namespace zlog
 
     /*
         %d 表示日期--包含子格式{%H-%M-%S}
-        %t 线程ID
+        %t 线程ID--子格式{tid}输出内核线程ID
+        %N 线程名称
         %c 日志器名称
         %f 源码文件名
         %l 行号
         %p 日志级别
         %T 制表符缩进
-        %m 主体消息
+        %m 主体消息--子格式{json}按JSON转义，{line}清洗为单行
         %n 表示换行
+        %j 结构化字段(JSON对象)
+        %k 结构化字段(logfmt)
+        %X 线程诊断上下文--子格式{key}输出单个字段
     */
 
     class Formatter
@@ -287,7 +390,9 @@ namespace zlog
                 }
             }
             else if (key == "t")
-                return std::make_shared<ThreadIdFormatItem>();
+                return std::make_shared<ThreadIdFormatItem>(val == "tid");
+            else if (key == "N")
+                return std::make_shared<ThreadNameFormatItem>();
             else if (key == "c")
                 return std::make_shared<LoggerFormatItem>();
             else if (key == "f")
@@ -299,9 +404,21 @@ namespace zlog
             else if (key == "T")
                 return std::make_shared<TabFormatItem>();
             else if (key == "m")
+            {
+                if (val == "json")
+                    return std::make_shared<MessageFormatItem>(MessageFormatItem::Mode::JSON);
+                else if (val == "line")
+                    return std::make_shared<MessageFormatItem>(MessageFormatItem::Mode::LINE);
                 return std::make_shared<MessageFormatItem>();
+            }
             else if (key == "n")
                 return std::make_shared<NLineFormatItem>();
+            else if (key == "j")
+                return std::make_shared<JsonFieldsFormatItem>();
+            else if (key == "k")
+                return std::make_shared<LogfmtFieldsFormatItem>();
+            else if (key == "X")
+                return std::make_shared<MdcFormatItem>(val);
 
             if (!key.empty())
             {
@@ -0,0 +1,149 @@
+#pragma once
+#include "level.hpp"
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+/*
+    日志文件的时间索引(旁路文件<日志文件>.idx)
+        1. 按固定时间间隔或数据量把日志文件划分为段，每段记录起止时间、起始偏移、长度与出现过的等级
+        2. 段在下一段开始或落地方向销毁时写入，索引只追加；进程崩溃时最后一段缺失，查询时作为未索引的尾部扫描
+        3. 时间为写入落地方向时的系统时间(毫秒)，段的起点总在记录边界上
+    由zlog-query读取，跳过时间范围或等级之外的段
+*/
+namespace zlog
+{
+    struct IndexHeader
+    {
+        char magic_[8]; // "ZLOGIDX1"
+        uint32_t version_;
+        uint32_t entrySize_;
+    };
+
+    struct IndexEntry
+    {
+        int64_t first_;   // 段内第一次写入的时间(毫秒)
+        int64_t last_;    // 段内最后一次写入的时间(毫秒)
+        uint64_t offset_; // 段在日志文件中的起始偏移
+        uint64_t length_; // 段的字节数
+        uint32_t levels_; // 段内出现过的等级(1 << LogLevel::value)，异步批量写入时不区分等级
+        uint32_t reserved_;
+    };
+
+    class TimeIndex
+    {
+    public:
+        static constexpr uint32_t INDEX_VERSION = 1;
+        static constexpr uint32_t ALL_LEVELS = 0xffffffffu;
+        static constexpr uint64_t DEFAULT_BYTE_INTERVAL = 1024 * 1024 * 4;
+
+        static uint32_t levelBit(LogLevel::value level)
+        {
+            return 1u << static_cast<uint32_t>(level);
+        }
+
+        static std::string indexPath(const std::string &logPath)
+        {
+            return logPath + ".idx";
+        }
+
+        TimeIndex(const std::string &logPath, std::chrono::milliseconds interval, uint64_t byteInterval = DEFAULT_BYTE_INTERVAL)
+            : path_(indexPath(logPath)), interval_(interval.count()), byteInterval_(byteInterval), open_(false)
+        {
+            fp_ = fopen(path_.c_str(), "ab");
+            if (fp_ == nullptr)
+            {
+                std::cerr << "打开索引文件失败: " << path_ << std::endl;
+                return;
+            }
+            if (ftell(fp_) == 0)
+            {
+                IndexHeader header;
+                memcpy(header.magic_, "ZLOGIDX1", 8);
+                header.version_ = INDEX_VERSION;
+                header.entrySize_ = sizeof(IndexEntry);
+                fwrite(&header, sizeof(header), 1, fp_);
+                fflush(fp_);
+            }
+        }
+
+        ~TimeIndex()
+        {
+            close();
+        }
+
+        TimeIndex(const TimeIndex &) = delete;
+        TimeIndex &operator=(const TimeIndex &) = delete;
+
+        // 日志文件在offset处写入了len字节，调用者保证串行
+        void note(uint64_t offset, size_t len, uint32_t levels)
+        {
+            int64_t now = nowMs();
+            if (open_ && (now - cur_.first_ >= interval_ || offset - cur_.offset_ >= byteInterval_ || offset != cur_.offset_ + cur_.length_))
+                finish();
+            if (!open_)
+            {
+                cur_.first_ = now;
+                cur_.offset_ = offset;
+                cur_.length_ = 0;
+                cur_.levels_ = 0;
+                cur_.reserved_ = 0;
+                open_ = true;
+            }
+            cur_.last_ = now;
+            cur_.length_ = offset + len - cur_.offset_;
+            cur_.levels_ |= levels;
+        }
+
+        // 写出当前段，日志文件切换或落地方向销毁时调用
+        void close()
+        {
+            if (fp_ == nullptr)
+                return;
+            finish();
+            fclose(fp_);
+            fp_ = nullptr;
+        }
+
+        // 读取索引文件，文件不存在或格式不符时返回false
+        static bool load(const std::string &logPath, std::vector<IndexEntry> &entries)
+        {
+            std::ifstream ifs(indexPath(logPath), std::ios::binary);
+            IndexHeader header;
+            if (!ifs.read(reinterpret_cast<char *>(&header), sizeof(header)) || memcmp(header.magic_, "ZLOGIDX1", 8) != 0 ||
+                header.version_ != INDEX_VERSION || header.entrySize_ != sizeof(IndexEntry))
+                return false;
+            IndexEntry entry;
+            while (ifs.read(reinterpret_cast<char *>(&entry), sizeof(entry)))
+                entries.push_back(entry);
+            return true;
+        }
+
+    private:
+        void finish()
+        {
+            if (!open_ || fp_ == nullptr)
+                return;
+            fwrite(&cur_, sizeof(cur_), 1, fp_);
+            fflush(fp_);
+            open_ = false;
+        }
+
+        static int64_t nowMs()
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        std::string path_;
+        FILE *fp_;
+        int64_t interval_;      // 段的最长时间跨度(毫秒)
+        uint64_t byteInterval_; // 段的最大字节数
+        bool open_;             // 当前段是否已有数据
+        IndexEntry cur_;
+    };
+};
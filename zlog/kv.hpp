@@ -0,0 +1,152 @@
+#pragma once
+#include "escape.hpp"
+#include <cmath>
+#include <string>
+#include <type_traits>
+#include <fmt/format.h>
+
+/*
+    结构化字段模块
+        1. zlog::kv(key, value) 只保存键与值的引用，不产生中间字符串
+        2. KvField 对字段进行类型擦除，由 %j/%k 格式化子项直接编码进输出缓冲区
+*/
+namespace zlog
+{
+    enum class KvEncoding
+    {
+        JSON,  // "key":value
+        LOGFMT // key=value
+    };
+
+    // 类型擦除后的字段
+    struct KvField
+    {
+        const char *key_;
+        const void *value_;
+        void (*encode_)(fmt::memory_buffer &buffer, const void *value, KvEncoding encoding);
+    };
+
+    // 按编码方式写入字符串取值
+    inline void writeKvString(fmt::memory_buffer &buffer, const char *data, size_t len, KvEncoding encoding)
+    {
+        if (encoding == KvEncoding::JSON)
+            Escape::jsonQuoted(buffer, data, len);
+        else
+            Escape::logfmt(buffer, data, len);
+    }
+
+    // 按值类型选择编码方式--通用类型：先格式化到线程局部缓冲区，再作为字符串转义写入
+    template <typename T, typename Enable = void>
+    struct KvEncoder
+    {
+        static void encode(fmt::memory_buffer &buffer, const void *value, KvEncoding encoding)
+        {
+            thread_local fmt::memory_buffer tmp;
+            tmp.clear();
+            fmt::format_to(std::back_inserter(tmp), "{}", *static_cast<const T *>(value));
+            writeKvString(buffer, tmp.data(), tmp.size(), encoding);
+        }
+    };
+
+    // 整数：直接输出数字（char按字符处理，见下方特化）
+    template <typename T>
+    struct KvEncoder<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+                                                !std::is_same<T, char>::value>::type>
+    {
+        static void encode(fmt::memory_buffer &buffer, const void *value, KvEncoding)
+        {
+            fmt::format_to(std::back_inserter(buffer), "{}", *static_cast<const T *>(value));
+        }
+    };
+
+    // 浮点数：JSON不支持nan/inf，输出null
+    template <typename T>
+    struct KvEncoder<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+    {
+        static void encode(fmt::memory_buffer &buffer, const void *value, KvEncoding encoding)
+        {
+            T v = *static_cast<const T *>(value);
+            if (encoding == KvEncoding::JSON && !std::isfinite(v))
+            {
+                fmt::format_to(std::back_inserter(buffer), "null");
+                return;
+            }
+            fmt::format_to(std::back_inserter(buffer), "{}", v);
+        }
+    };
+
+    template <>
+    struct KvEncoder<bool>
+    {
+        static void encode(fmt::memory_buffer &buffer, const void *value, KvEncoding)
+        {
+            if (*static_cast<const bool *>(value))
+                fmt::format_to(std::back_inserter(buffer), "true");
+            else
+                fmt::format_to(std::back_inserter(buffer), "false");
+        }
+    };
+
+    // 单个字符：作为长度为1的字符串转义写入，避免输出裸字符破坏JSON/logfmt
+    template <>
+    struct KvEncoder<char>
+    {
+        static void encode(fmt::memory_buffer &buffer, const void *value, KvEncoding encoding)
+        {
+            writeKvString(buffer, static_cast<const char *>(value), 1, encoding);
+        }
+    };
+
+    // 字符串类：C字符串、字符数组、std::string
+    template <typename T>
+    struct KvEncoder<T, typename std::enable_if<std::is_same<T, const char *>::value ||
+                                                std::is_same<T, char *>::value>::type>
+    {
+        static void encode(fmt::memory_buffer &buffer, const void *value, KvEncoding encoding)
+        {
+            const char *str = *static_cast<const T *>(value);
+            if (str == nullptr)
+                str = "";
+            writeKvString(buffer, str, strlen(str), encoding);
+        }
+    };
+
+    template <size_t N>
+    struct KvEncoder<char[N]>
+    {
+        static void encode(fmt::memory_buffer &buffer, const void *value, KvEncoding encoding)
+        {
+            const char *str = static_cast<const char *>(value);
+            writeKvString(buffer, str, strlen(str), encoding);
+        }
+    };
+
+    template <>
+    struct KvEncoder<std::string>
+    {
+        static void encode(fmt::memory_buffer &buffer, const void *value, KvEncoding encoding)
+        {
+            const std::string &str = *static_cast<const std::string *>(value);
+            writeKvString(buffer, str.data(), str.size(), encoding);
+        }
+    };
+
+    // 键值对：仅持有引用，生命周期限于一次日志调用的完整表达式
+    template <typename T>
+    struct KeyValue
+    {
+        const char *key_;
+        const T &value_;
+
+        KvField field() const
+        {
+            return KvField{key_, &value_, &KvEncoder<T>::encode};
+        }
+    };
+
+    template <typename T>
+    inline KeyValue<T> kv(const char *key, const T &value)
+    {
+        return KeyValue<T>{key, value};
+    }
+};
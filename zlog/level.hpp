@@ -23,7 +23,8 @@ namespace zlog
             OFF,
         };
         
-        static std::string toString(LogLevel::value level)
+        // 返回静态字符串，格式化时无需构造std::string
+        static const char *toString(LogLevel::value level)
         {
             switch (level)
             {
@@ -1,3 +1,4 @@
+#pragma once
 /*
     完成日志器模块
         1. 同步日志器
@@ -12,22 +13,32 @@
 #include "message.hpp"
 #include "sink.hpp"
 #include "looper.hpp"
+#include "stage.hpp"
+#include "backtrace.hpp"
+#include "profile.hpp"
 #include <unordered_map>
+#include <map>
 #include <mutex>
 #include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <fmt/format.h>
+#include <future>
+#include <functional>
 
 namespace zlog
 {
+    static constexpr size_t MAX_RETAINED_FORMAT_BUFFER = 1024 * 1024; // 线程局部格式化缓冲区超过该容量时在使用后释放
 
-    class Logger
+    class Logger : public std::enable_shared_from_this<Logger>
     {
     public:
         using ptr = std::shared_ptr<Logger>;
         Logger(const char *loggerName, LogLevel::value limitLevel,
                Formatter::ptr &formatter,
                std::vector<LogSink::ptr> &sinks) : loggerName_(loggerName),
-                                                   limitLevel_(limitLevel), formatter_(formatter), sinks_(sinks.begin(), sinks.end())
+                                                   limitLevel_(limitLevel), formatter_(formatter), sinks_(sinks.begin(), sinks.end()),
+                                                   sinkOwner_(this), inherits_(false), backtraceLevel_(LogLevel::value::OFF)
         {
         }
 
@@ -36,17 +47,121 @@ namespace zlog
             return std::string(loggerName_);
         }
 
+        // 运行时修改等级，层级日志器由LoggerManager统一下发有效等级
+        void setLevel(LogLevel::value level)
+        {
+            limitLevel_.store(level, std::memory_order_relaxed);
+        }
+
+        LogLevel::value getLevel() const
+        {
+            return limitLevel_.load(std::memory_order_relaxed);
+        }
+
+        // 未配置落地方向的子日志器复用祖先的落地流程；祖先可能在之后注册，由LoggerManager重新指向
+        void inheritSinks(Logger *ancestor)
+        {
+            inherits_ = true;
+            sinkOwner_.store(ancestor->sinkOwner_.load(std::memory_order_acquire), std::memory_order_release);
+        }
+
+        bool inheritsSinks() const
+        {
+            return inherits_;
+        }
+
+        // 开启回溯环：低于日志器等级的记录格式化后保存在capacity字节的环中，
+        // 出现不低于trigger的记录时先落地；须在开始写日志前调用
+        void enableBacktrace(size_t capacity, LogLevel::value trigger)
+        {
+            backtrace_.reset(new Backtrace(capacity));
+            backtraceLevel_ = trigger;
+        }
+
+        // 调用前写入的记录全部落地(sync为真时还同步到存储设备)后调用done；
+        // 同步日志器在返回前完成，异步日志器在后台线程中调用done
+        void flush(const std::function<void()> &done, bool sync = false)
+        {
+            sinkOwner_.load(std::memory_order_acquire)->flushSinks(done, sync);
+        }
+
+        // 返回在flush完成时就绪的future
+        std::future<void> flush(bool sync = false)
+        {
+            std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
+            std::future<void> future = promise->get_future();
+            flush([promise]()
+                  { promise->set_value(); },
+                  sync);
+            return future;
+        }
+
+        // 停止后台工作器：落地剩余数据后退出，之后不应再写入；同步日志器没有后台工作器
+        virtual void stop() {}
+
+        // 运行时统计快照：各等级的记录数与字节数、异步工作器与落地方向的统计
+        LoggerSnapshot snapshot()
+        {
+            LoggerSnapshot snap;
+            snap.name_ = loggerName_;
+            for (size_t i = 0; i < LoggerSnapshot::LEVELS; ++i)
+            {
+                snap.records_[i] = records_[i].value();
+                snap.bytes_[i] = bytes_[i].value();
+            }
+            collectLoopers(snap.loopers_);
+            for (auto &sink : sinks_)
+            {
+                SinkSnapshot sinkSnap;
+                sinkSnap.name_ = sink->name();
+                sinkSnap.writes_ = sink->stats().writes_.value();
+                sinkSnap.bytes_ = sink->stats().bytes_.value();
+                sinkSnap.errors_ = sink->stats().errors_.value();
+                sinkSnap.drops_ = sink->stats().drops_.value();
+                sinkSnap.latency_ = sink->stats().latency_.snapshot();
+                snap.sinks_.push_back(sinkSnap);
+            }
+            return snap;
+        }
+
+        // 立即落地回溯环中的记录
+        void dumpBacktrace()
+        {
+            if (!backtrace_)
+                return;
+            thread_local fmt::memory_buffer buffer;
+            buffer.clear();
+            backtrace_->take(buffer);
+            if (buffer.size() > 0)
+                sinkOwner_.load(std::memory_order_acquire)->log(LogLevel::value::DEBUG, buffer.data(), buffer.size());
+        }
+
         template <typename Level, typename... Args>
         void logImpl(Level level, const char *file, size_t line, const char *fmt, Args &&...args)
         {
             logImplHelper(level, file, line, fmt, std::forward<Args>(args)...);
         }
 
+        // 结构化日志：消息原样输出，字段由 %j/%k 直接编码进输出缓冲区
+        template <typename Level, typename... Ts>
+        void logKvImpl(Level level, const char *file, size_t line, const char *message, const KeyValue<Ts> &...kvs)
+        {
+            ZLOG_PROFILE_CALL(file, line);
+            if (level < limitLevel_ && !backtrace_)
+                return;
+
+            // 字段数组位于栈上，多出一个元素避免零长度数组
+            KvField fields[sizeof...(Ts) + 1] = {kvs.field()...};
+            serialize(level, file, line, message, strlen(message), fields, sizeof...(Ts));
+        }
+
     protected:
         template <typename... Args>
         void logImplHelper(LogLevel::value level, const char *file, size_t line, const char *fmt, Args &&...args)
         {
-            if (level < limitLevel_)
+            ZLOG_PROFILE_CALL(file, line);
+            // 开启回溯环时低于等级的记录仍需格式化后保存
+            if (level < limitLevel_ && !backtrace_)
                 return;
 
             // 线程局部缓冲区，预分配内存并复用
@@ -60,12 +175,21 @@ namespace zlog
             fmtBuffer.push_back('\0');
 
             // 使用缓冲区内容（例如输出或转换为字符串）
-            serialize(level, file, line, fmtBuffer.data());
+            serialize(level, file, line, fmtBuffer.data(), fmtBuffer.size() - 1);
+            trim(fmtBuffer);
+        }
+
+        // 偶发的超大记录之后释放线程局部缓冲区，避免每个线程长期占用同样大小的内存
+        static void trim(fmt::memory_buffer &buffer)
+        {
+            if (buffer.capacity() > MAX_RETAINED_FORMAT_BUFFER)
+                buffer = fmt::memory_buffer();
         }
 
-        void serialize(LogLevel::value level, const char *file, size_t line, const char *data)
+        void serialize(LogLevel::value level, const char *file, size_t line, const char *data, size_t len,
+                       const KvField *fields = nullptr, size_t fieldCount = 0)
         {
-            // 使用线程本地的LogMessage对象，避免频繁分配释放
+            // 使用线程本地的LogMessage对象，避免频繁分配释放；线程ID在构造时确定，无需每次更新
             thread_local LogMessage msg(LogLevel::value::DEBUG, "", 0, "", "");
 
             msg.curtime_ = Date::getCurrentTime();
@@ -74,19 +198,62 @@ namespace zlog
             msg.level_ = level;
             msg.file_ = file;
             msg.line_ = line;
-            msg.tid_ = std::this_thread::get_id();
             msg.payload_ = data;
+            msg.payloadLen_ = len;
             msg.loggerName_ = loggerName_;
+            msg.fields_ = fields;
+            msg.fieldCount_ = fieldCount;
 
             // 格式化
             thread_local fmt::memory_buffer buffer;
             buffer.clear();
             formatter_->format(buffer, msg);
+            ZLOG_PROFILE_FORMATTED(file, line, buffer.size(), !backtrace_ || level >= limitLevel_);
+
+            if (backtrace_ && level < limitLevel_)
+            {
+                backtrace_->push(buffer.data(), buffer.size());
+                return;
+            }
+            records_[static_cast<size_t>(level)].add();
+            bytes_[static_cast<size_t>(level)].add(buffer.size());
+
+            if (backtrace_)
+            {
+                // 回溯记录与触发记录合并为一次落地，保证二者顺序
+                if (level >= backtraceLevel_)
+                {
+                    thread_local fmt::memory_buffer dump;
+                    dump.clear();
+                    backtrace_->take(dump);
+                    dump.append(buffer.data(), buffer.data() + buffer.size());
+                    sinkOwner_.load(std::memory_order_acquire)->log(level, dump.data(), dump.size());
+                    trim(dump);
+                    trim(buffer);
+                    return;
+                }
+            }
 
             // 日志落地
-            log(buffer.data(), buffer.size());
+            sinkOwner_.load(std::memory_order_acquire)->log(level, buffer.data(), buffer.size());
+            trim(buffer);
+        }
+        virtual void log(LogLevel::value level, const char *data, size_t len) = 0;
+        virtual void flushSinks(const std::function<void()> &done, bool sync) = 0;
+
+        // 异步日志器填充工作器统计
+        virtual void collectLoopers(std::vector<LooperSnapshot> &) {}
+
+        // 调用者保证没有并发写入
+        void flushEachSink(bool sync)
+        {
+            for (auto &sink : sinks_)
+            {
+                sink->flush();
+                if (sync)
+                    sink->sync();
+            }
         }
-        virtual void log(const char *data, size_t len) = 0;
 
     protected:
         std::mutex mutex_;
@@ -94,32 +261,65 @@ namespace zlog
         std::atomic<LogLevel::value> limitLevel_;
         Formatter::ptr formatter_;
         std::vector<LogSink::ptr> sinks_;
+        std::atomic<Logger *> sinkOwner_; // 实际负责落地的日志器，自身或祖先
+        bool inherits_;                   // 是否继承祖先的落地方向
+        Backtrace::ptr backtrace_;      // 回溯环，未开启时为空
+        LogLevel::value backtraceLevel_; // 触发回溯落地的等级
+        Counter records_[LoggerSnapshot::LEVELS]; // 各等级写出的记录数
+        Counter bytes_[LoggerSnapshot::LEVELS];   // 各等级写出的字节数
     };
 
-    /*同步日志器负责通过日志落地模块进行落地*/
+    /*同步日志器负责通过日志落地模块进行落地；所有落地方向均线程安全时不加锁*/
     class SyncLogger : public Logger
     {
     public:
         SyncLogger(const char *loggerName, LogLevel::value limitLevel,
                    Formatter::ptr &formatter,
-                   std::vector<LogSink::ptr> &sinks) : Logger(loggerName, limitLevel, formatter, sinks)
+                   std::vector<LogSink::ptr> &sinks) : Logger(loggerName, limitLevel, formatter, sinks),
+                                                       lockFree_(true)
         {
+            for (auto &sink : sinks_)
+                lockFree_ = lockFree_ && sink->threadSafe();
         }
 
     protected:
-        void log(const char *data, size_t len) override
+        void log(LogLevel::value level, const char *data, size_t len) override
         {
-            std::unique_lock<std::mutex> lock(mutex_);
+            std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+            if (!lockFree_)
+                lock.lock();
             if (sinks_.empty())
                 return;
             for (auto &sink : sinks_)
             {
-                sink->log(data, len);
+                sink->emit(level, data, len);
             }
         }
+
+        void flushSinks(const std::function<void()> &done, bool sync) override
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+                if (!lockFree_)
+                    lock.lock();
+                flushEachSink(sync);
+            }
+            if (done)
+                done();
+        }
+
+    protected:
+        bool lockFree_;
     };
 
-    /*异步日志器*/
+    /*
+        异步日志器
+            开启NUMA分片时每个节点一个后台队列，工作线程绑定到节点的CPU、缓冲区放置在节点内存上；
+            线程第一次写入时固定到当时所在节点的队列，之后迁移到其他节点也不改变，保证同一线程的记录不乱序；
+            各分片的落地与flush由sinkMutex_串行化
+            开启写合并时记录先进入线程局部暂存区，批量提交到工作器；暂存区记住所属线程的分片，
+            由后台回收或drain/flush代为提交时也写入该分片，与线程直接写入的记录保持顺序
+    */
     class AsyncLogger : public Logger
     {
     public:
@@ -127,33 +327,178 @@ namespace zlog
                     Formatter::ptr &formatter,
                     std::vector<LogSink::ptr> &sinks, AsyncType looperType,
                     std::chrono::milliseconds milliseco) : Logger(loggerName, limitLevel, formatter, sinks),
-                                                           looper_(std::make_shared<AsyncLooper>(std::bind(&AsyncLogger::reLog,
-                                                                                                           this, std::placeholders::_1),
-                                                                                                 looperType, milliseco))
+                                                           priorityLevel_(LogLevel::value::OFF)
+
+        {
+            loopers_.push_back(std::make_shared<AsyncLooper>(std::bind(&AsyncLogger::reLog, this, std::placeholders::_1),
+                                                             looperType, milliseco));
+        }
 
+        AsyncLogger(const char *loggerName, LogLevel::value limitLevel,
+                    Formatter::ptr &formatter,
+                    std::vector<LogSink::ptr> &sinks,
+                    const AsyncOptions &options) : Logger(loggerName, limitLevel, formatter, sinks),
+                                                   priorityLevel_(options.priorityLevel_)
+        {
+            AsyncOptions base = options;
+            if (options.stageSize_ > 0)
+            {
+                stages_ = std::make_shared<StageGroup>(std::bind(&AsyncLogger::submit, this, std::placeholders::_1,
+                                                                 std::placeholders::_2, std::placeholders::_3, std::placeholders::_4),
+                                                       std::bind(&AsyncLogger::shard, this),
+                                                       options.stageSize_, options.stageDelay_, options.stageFlushLevel_);
+                // 工作器先于stages_析构，钩子中可直接使用裸指针
+                StageGroup *group = stages_.get();
+                base.idleHook_ = [group]()
+                { group->collect(); };
+            }
+
+            // 共享线程池由调用者管理线程，不做分片
+            int shards = base.numaSharding_ && !base.backend_ ? Numa::nodeCount() : 1;
+            for (int node = 0; node < shards; ++node)
+            {
+                AsyncOptions shard = base;
+                if (shards > 1)
+                {
+                    shard.numaNode_ = node;
+                    if (shard.thread_.cpus_.empty())
+                        shard.thread_.cpus_ = Numa::cpusOfNode(node);
+                    if (!shard.thread_.name_.empty())
+                        shard.thread_.name_ += "-n" + std::to_string(node);
+                    if (!shard.ringPath_.empty())
+                        shard.ringPath_ += ".n" + std::to_string(node);
+                }
+                loopers_.push_back(std::make_shared<AsyncLooper>(std::bind(&AsyncLogger::reLog, this, std::placeholders::_1),
+                                                                 shard));
+            }
+        }
+
+        ~AsyncLogger()
         {
+            stop();
+        }
+
+        void stop() override
+        {
+            // 提交所有线程的暂存区，此后线程退出时不再提交
+            if (stages_)
+                stages_->close();
+            for (auto &looper : loopers_)
+                looper->stop();
+        }
+
+        // 批量落地的统计与当前决策；分片时为节点0的统计
+        BatchStats batchStats()
+        {
+            return loopers_.front()->batchStats();
+        }
+
+        // 等待此前写入的全部记录(含各线程暂存区)落地
+        void drain()
+        {
+            if (stages_)
+                stages_->flushAll();
+            for (auto &looper : loopers_)
+                looper->drain();
         }
 
     protected:
-        // 将数据写入到缓冲区
-        void log(const char *data, size_t len) override
+        // 将数据写入到缓冲区；高等级记录走高优先级通道，FATAL无论是否开启该通道都走高优先级通道并在返回前等待全部数据落地
+        void log(LogLevel::value level, const char *data, size_t len) override
+        {
+            if (level < priorityLevel_ && level != LogLevel::value::FATAL)
+            {
+                if (stages_)
+                    stages_->append(level, data, len);
+                else
+                    current()->push(data, len);
+                return;
+            }
+            // 先提交本线程暂存的低等级记录
+            if (stages_)
+                stages_->flushCurrent();
+            // 两条通道之间不保证顺序，FATAL先等此前的记录落地，保证它是最后一条
+            if (level == LogLevel::value::FATAL)
+                drain();
+            current()->pushUrgent(data, len);
+            if (level == LogLevel::value::FATAL)
+                drain();
+        }
+
+        // 当前线程的分片：第一次写入时按所在节点选定，之后不再改变
+        //   各分片独立落地，线程若随迁移切换分片，自己的记录会在落地方向中乱序
+        //   分片数总是1或节点数，所有日志器可共用同一个线程局部的节点号
+        int shard()
+        {
+            if (loopers_.size() == 1)
+                return 0;
+            thread_local int node = Numa::currentNode();
+            return static_cast<int>(static_cast<size_t>(node) % loopers_.size());
+        }
+
+        // 仅供生产者线程自身写入；代其他线程提交的路径须使用暂存区记录的分片，见submit
+        AsyncLooper::ptr &current()
+        {
+            return loopers_[static_cast<size_t>(shard())];
+        }
+
+        // 暂存区提交目标：写入暂存区所属线程的分片，而不是执行提交的线程(后台回收、drain)的分片
+        bool submit(int shard, const char *data, size_t len, bool block)
+        {
+            AsyncLooper::ptr &looper = loopers_[static_cast<size_t>(shard)];
+            if (block)
+            {
+                looper->push(data, len);
+                return true;
+            }
+            return looper->tryPush(data, len);
+        }
+
+        // 所有分片完成后同步落地方向，再调用done
+        void flushSinks(const std::function<void()> &done, bool sync) override
+        {
+            if (stages_)
+                stages_->flushAll();
+            std::shared_ptr<std::atomic<size_t>> left = std::make_shared<std::atomic<size_t>>(loopers_.size());
+            std::function<void()> finish = [this, left, done, sync]()
+            {
+                if (left->fetch_sub(1) != 1)
+                    return;
+                {
+                    std::unique_lock<std::mutex> lock(sinkMutex_);
+                    flushEachSink(sync);
+                }
+                if (done)
+                    done();
+            };
+            for (auto &looper : loopers_)
+                looper->flush(finish);
+        }
+
+        void collectLoopers(std::vector<LooperSnapshot> &loopers) override
         {
-            looper_->push(data, len);
+            for (auto &looper : loopers_)
+                loopers.push_back(looper->snapshot());
         }
 
-        // 设计一个实际落地函数，将数据从缓冲区中落地
+        // 设计一个实际落地函数，将数据从缓冲区中落地；与flush串行
         void reLog(Buffer &buffer)
         {
             if (sinks_.empty())
                 return;
+            std::unique_lock<std::mutex> lock(sinkMutex_);
             for (auto &sink : sinks_)
             {
-                sink->log(buffer.begin(), buffer.readAbleSize());
+                sink->emit(buffer.begin(), buffer.readAbleSize());
             }
         }
 
     protected:
-        AsyncLooper::ptr looper_;
+        // 工作器析构时仍会落地剩余数据，暂存区与sinkMutex_须先于工作器声明
+        StageGroup::ptr stages_; // 写合并暂存区，未开启时为空
+        std::mutex sinkMutex_;
+        std::vector<AsyncLooper::ptr> loopers_;
+        LogLevel::value priorityLevel_;
     };
 
     /*使用建造者模式，降低使用户使用成本*/
@@ -189,6 +534,7 @@ namespace zlog
         void buildLoggerLevel(LogLevel::value limitLevel)
         {
             limitLevel_ = limitLevel;
+            levelSet_ = true;
         }
 
         void buildWaitTime(std::chrono::milliseconds milliseco)
@@ -196,6 +542,107 @@ namespace zlog
             milliseco_ = milliseco;
         }
 
+        // 异步缓冲区初始大小，数据量达到一半时唤醒后台
+        void buildBufferSize(size_t bufferSize)
+        {
+            bufferSize_ = bufferSize;
+        }
+
+        // 超过size的记录不进入异步缓冲区，单独存放后按顺序落地并立即释放；0表示缓冲区大小的一半
+        void buildLargeRecordSize(size_t size)
+        {
+            largeRecordSize_ = size;
+        }
+
+        // 不低于该等级的记录走高优先级通道，立即落地
+        void buildPriorityLevel(LogLevel::value level)
+        {
+            priorityLevel_ = level;
+        }
+
+        // 目标落地延迟：后台按到达速率与落地开销自适应调整批量与唤醒间隔
+        void buildTargetLatency(std::chrono::milliseconds latency)
+        {
+            targetLatency_ = latency;
+        }
+
+        // 独占工作线程与ASYNC_SAFE生产者的等待方式，延迟敏感场景可让日志线程独占一个核心
+        void buildWaitStrategy(WaitStrategy strategy)
+        {
+            waitStrategy_ = strategy;
+        }
+
+        // 由共享后台线程池服务，多个异步日志器可共用同一个线程池
+        void buildSharedBackend(const AsyncBackend::ptr &backend)
+        {
+            backend_ = backend;
+        }
+
+        // 后台工作线程绑定的CPU
+        void buildBackendAffinity(const std::vector<int> &cpus)
+        {
+            threadOptions_.cpus_ = cpus;
+        }
+
+        // 后台工作线程的nice值
+        void buildBackendNice(int nice)
+        {
+            threadOptions_.nice_ = nice;
+            threadOptions_.niceSet_ = true;
+        }
+
+        // 后台工作线程的调度策略与优先级，如SCHED_FIFO；实时策略通常需要CAP_SYS_NICE
+        void buildBackendScheduling(int policy, int priority)
+        {
+            threadOptions_.policy_ = policy;
+            threadOptions_.priority_ = priority;
+        }
+
+        // 后台工作线程名称，便于在top/perf中识别
+        void buildBackendName(const std::string &name)
+        {
+            threadOptions_.name_ = name;
+        }
+
+        // 将异步缓冲区放置在指定NUMA节点的内存上
+        void buildNumaNode(int node)
+        {
+            numaNode_ = node;
+        }
+
+        // 每个NUMA节点一个后台队列与工作线程，生产者写入本节点队列，避免跨节点访问缓冲区；
+        // 线程固定使用第一次写入时所在节点的队列，迁移后仍保持自身记录的顺序
+        void buildNumaSharding(bool enable = true)
+        {
+            numaSharding_ = enable;
+        }
+
+        // 生产者写合并：记录先写入线程局部暂存区，达到stageSize、滞留超过maxDelay、
+        // 出现不低于flushLevel的记录或线程退出时一次性提交，适合频繁写日志的线程
+        void buildWriteCombining(size_t stageSize = 4096,
+                                 std::chrono::milliseconds maxDelay = std::chrono::milliseconds(1),
+                                 LogLevel::value flushLevel = LogLevel::value::WARNING)
+        {
+            stageSize_ = stageSize;
+            stageDelay_ = maxDelay;
+            stageFlushLevel_ = flushLevel;
+        }
+
+        // 飞行记录：未落地的数据同时写入文件映射环(如/dev/shm/app.ring)，进程崩溃后用zlog-recover取回；
+        // size为0时取缓冲区大小的4倍
+        void buildFlightRecorder(const std::string &path, size_t size = 0)
+        {
+            ringPath_ = path;
+            ringSize_ = size;
+        }
+
+        // 回溯环：低于日志器等级的记录只保存在内存中，出现不低于trigger的记录时先于它落地
+        void buildBacktrace(size_t capacity = 1024 * 64, LogLevel::value trigger = LogLevel::value::ERROR)
+        {
+            backtraceSize_ = capacity;
+            backtraceLevel_ = trigger;
+        }
+
         void buildLoggerFormatter(const std::string &pattern)
         {
             formatter_ = std::make_shared<Formatter>(pattern);
@@ -213,10 +660,49 @@ namespace zlog
         LoggerType loggerType_;
         const char *loggerName_ = nullptr;
         LogLevel::value limitLevel_;
+        bool levelSet_ = false; // 未显式设置时全局日志器继承祖先等级
         Formatter::ptr formatter_;
         std::vector<LogSink::ptr> sinks_;
         AsyncType looperType_;
         std::chrono::milliseconds milliseco_;
+        size_t bufferSize_ = DEFAULT_BUFFER_SIZE;
+        AsyncBackend::ptr backend_;
+        LogLevel::value priorityLevel_ = LogLevel::value::OFF;
+        std::chrono::milliseconds targetLatency_ = std::chrono::milliseconds(0);
+        WaitStrategy waitStrategy_ = WaitStrategy::BLOCKING;
+        ThreadOptions threadOptions_;
+        int numaNode_ = -1;
+        bool numaSharding_ = false;
+        size_t stageSize_ = 0;
+        std::chrono::milliseconds stageDelay_ = std::chrono::milliseconds(1);
+        LogLevel::value stageFlushLevel_ = LogLevel::value::WARNING;
+        std::string ringPath_;
+        size_t ringSize_ = 0;
+        size_t largeRecordSize_ = 0;
+        size_t backtraceSize_ = 0;
+        LogLevel::value backtraceLevel_ = LogLevel::value::ERROR;
+
+        AsyncOptions asyncOptions() const
+        {
+            AsyncOptions options;
+            options.looperType_ = looperType_;
+            options.milliseco_ = milliseco_;
+            options.bufferSize_ = bufferSize_;
+            options.backend_ = backend_;
+            options.priorityLevel_ = priorityLevel_;
+            options.targetLatency_ = targetLatency_;
+            options.waitStrategy_ = waitStrategy_;
+            options.thread_ = threadOptions_;
+            options.numaNode_ = numaNode_;
+            options.numaSharding_ = numaSharding_;
+            options.stageSize_ = stageSize_;
+            options.stageDelay_ = stageDelay_;
+            options.stageFlushLevel_ = stageFlushLevel_;
+            options.ringPath_ = ringPath_;
+            options.ringSize_ = ringSize_;
+            options.largeRecordSize_ = largeRecordSize_;
+            return options;
+        }
     };
 
     /* 局部日志器建造者 */
@@ -241,15 +727,32 @@ namespace zlog
                 buildLoggerSink<StdOutSink>();
             }
 
+            Logger::ptr logger;
             if (loggerType_ == LoggerType::LOGGER_ASYNC)
             {
-                return std::make_shared<AsyncLogger>(loggerName_, limitLevel_, formatter_, sinks_, looperType_, milliseco_);
+                logger = std::make_shared<AsyncLogger>(loggerName_, limitLevel_, formatter_, sinks_, asyncOptions());
+            }
+            else
+            {
+                logger = std::make_shared<SyncLogger>(loggerName_, limitLevel_, formatter_, sinks_);
             }
-            return std::make_shared<SyncLogger>(loggerName_, limitLevel_, formatter_, sinks_);
+            if (backtraceSize_ > 0)
+                logger->enableBacktrace(backtraceSize_, backtraceLevel_);
+            return logger;
         }
     };
 
-    /*全局日志管理器，负责将每个日志器管理并实现全局访问*/
+    /*
+        全局日志管理器，负责将每个日志器管理并实现全局访问
+            1. 查找基于不可变快照，读者不加锁：登记到当前读者计数后加载快照
+            2. 添加日志器时在写锁内复制快照并发布新快照
+            3. 读者计数分两组交替使用：发布新快照后切换分组，等待旧分组清零即可释放旧快照，
+               任何时刻只保留当前快照；日志器本身不会被移除，查找返回的指针始终有效
+            4. 以'.'分隔的名称构成层级(net.http.client)，root为所有日志器的祖先；
+               修改某一层级的等级时，将有效等级写入每个后代的limitLevel_，日志调用时无需遍历层级
+            5. 继承落地方向的日志器指向最近的、有自己落地方向的已注册祖先(都没有时为root)；
+               注册新日志器时重新指向其后代，与注册顺序无关
+    */
     class LoggerManager
     {
     public:
@@ -258,33 +761,85 @@ namespace zlog
             static LoggerManager eton;
             return eton;
         }
-        void addLogger(Logger::ptr &logger)
+
+        // 名称已存在时不覆盖；explicitLevel为假时日志器继承祖先的有效等级
+        void addLogger(Logger::ptr &logger, bool explicitLevel = true)
         {
-            if (hasLogger(logger->getName()))
+            std::unique_lock<std::mutex> lock(mutex_);
+            const Registry *cur = registry_.load(std::memory_order_relaxed);
+            std::string name = logger->getName();
+            if (cur->find(name.c_str(), name.size()) != nullptr)
                 return;
+            publish(new Registry(*cur, name, logger));
+            if (explicitLevel)
+                applyLevel(name, logger->getLevel());
+            else
+                logger->setLevel(effectiveLevel(name));
+            relink(name);
+        }
+
+        // 设置某一层级的等级(无需存在同名日志器)，并下发到所有未单独设置等级的后代
+        void setLevel(const std::string &name, LogLevel::value level)
+        {
             std::unique_lock<std::mutex> lock(mutex_);
-            loggers_.insert({logger->getName(), logger});
+            applyLevel(name, level);
         }
 
-        bool hasLogger(const std::string &name)
+        // 取消某一层级的等级设置，使其重新继承祖先
+        void resetLevel(const std::string &name)
         {
             std::unique_lock<std::mutex> lock(mutex_);
-            auto iter = loggers_.find(name);
-            if (iter == loggers_.end())
+            levels_.erase(name);
+            refresh(name);
+        }
+
+        // 最近的已注册祖先(不含root)，不存在返回nullptr
+        Logger *findAncestor(const std::string &name)
+        {
+            std::string cur = name;
+            size_t pos;
+            while ((pos = cur.rfind('.')) != std::string::npos)
             {
-                return false;
+                cur.resize(pos);
+                Logger *logger = find(cur.c_str(), cur.size());
+                if (logger != nullptr)
+                    return logger;
             }
-            return true;
+            return nullptr;
+        }
+
+        bool hasLogger(const std::string &name)
+        {
+            return find(name.c_str(), name.size()) != nullptr;
         }
+
         Logger::ptr getLogger(const std::string &name)
         {
-            std::unique_lock<std::mutex> lock(mutex_);
-            auto iter = loggers_.find(name);
-            if (iter == loggers_.end())
+            return getLogger(name.c_str());
+        }
+
+        Logger::ptr getLogger(const char *name)
+        {
+            Logger *logger = find(name, strlen(name));
+            if (logger == nullptr)
             {
                 return Logger::ptr(); // 匿名对象
             }
-            return iter->second;
+            return logger->shared_from_this();
+        }
+
+        // 无引用计数的查找，日志器注册后不会被移除，返回的指针在进程内始终有效
+        Logger *find(const char *name, size_t len)
+        {
+            ReadGuard guard(*this);
+            return registry_.load(std::memory_order_seq_cst)->find(name, len);
+        }
+
+        // 快照版本号，每次添加日志器加一
+        uint64_t version()
+        {
+            ReadGuard guard(*this);
+            return registry_.load(std::memory_order_seq_cst)->version_;
         }
 
         Logger::ptr rootLogger()
@@ -292,19 +847,276 @@ namespace zlog
             return rootLogger_;
         }
 
+        // 当前注册的全部日志器
+        std::vector<Logger::ptr> loggers()
+        {
+            std::vector<Logger::ptr> result;
+            ReadGuard guard(*this);
+            for (auto &entry : registry_.load(std::memory_order_seq_cst)->entries_)
+                result.push_back(entry.logger_);
+            return result;
+        }
+
     private:
+        // 读者登记：在当前分组计数，析构时撤销
+        //   读取分组与计数之间写者可能已切换分组并释放快照，之后的写者不会再等待该分组；
+        //   因此计数后重新确认分组未变，否则撤销并重试，保证计数所在分组总是写者下一次要等待的分组
+        class ReadGuard
+        {
+        public:
+            explicit ReadGuard(LoggerManager &manager)
+            {
+                uint32_t gen = manager.readerGen_.load(std::memory_order_seq_cst);
+                while (true)
+                {
+                    count_ = &manager.readers_[gen & 1];
+                    count_->fetch_add(1, std::memory_order_seq_cst);
+                    uint32_t now = manager.readerGen_.load(std::memory_order_seq_cst);
+                    if (now == gen)
+                        break;
+                    count_->fetch_sub(1, std::memory_order_release);
+                    gen = now;
+                }
+            }
+
+            ~ReadGuard()
+            {
+                count_->fetch_sub(1, std::memory_order_release);
+            }
+
+            ReadGuard(const ReadGuard &) = delete;
+            ReadGuard &operator=(const ReadGuard &) = delete;
+
+        private:
+            std::atomic<uint32_t> *count_;
+        };
+
+        // 不可变快照：开放寻址哈希表
+        struct Registry
+        {
+            struct Entry
+            {
+                size_t hash_;
+                std::string name_;
+                Logger::ptr logger_;
+            };
+
+            Registry()
+                : version_(0)
+            {
+                rehash();
+            }
+
+            Registry(const Registry &old, const std::string &name, const Logger::ptr &logger)
+                : entries_(old.entries_), version_(old.version_ + 1)
+            {
+                entries_.push_back({hash(name.c_str(), name.size()), name, logger});
+                rehash();
+            }
+
+            Logger *find(const char *name, size_t len) const
+            {
+                size_t h = hash(name, len);
+                size_t mask = slots_.size() - 1;
+                for (size_t i = h & mask;; i = (i + 1) & mask)
+                {
+                    const Entry *entry = slots_[i];
+                    if (entry == nullptr)
+                        return nullptr;
+                    if (entry->hash_ == h && entry->name_.size() == len &&
+                        memcmp(entry->name_.data(), name, len) == 0)
+                        return entry->logger_.get();
+                }
+            }
+
+            static size_t hash(const char *name, size_t len)
+            {
+                size_t h = 14695981039346656037ULL; // FNV-1a
+                for (size_t i = 0; i < len; ++i)
+                {
+                    h ^= static_cast<unsigned char>(name[i]);
+                    h *= 1099511628211ULL;
+                }
+                return h;
+            }
+
+            // 装载因子不超过1/2
+            void rehash()
+            {
+                size_t n = 8;
+                while (n < entries_.size() * 2)
+                    n *= 2;
+                slots_.assign(n, nullptr);
+                for (auto &entry : entries_)
+                {
+                    size_t i = entry.hash_ & (n - 1);
+                    while (slots_[i] != nullptr)
+                        i = (i + 1) & (n - 1);
+                    slots_[i] = &entry;
+                }
+            }
+
+            std::vector<Entry> entries_;
+            std::vector<const Entry *> slots_;
+            uint64_t version_;
+        };
+
         LoggerManager()
+            : readerGen_(0)
         {
+            readers_[0].store(0);
+            readers_[1].store(0);
             std::unique_ptr<zlog::LocalLoggerBuilder> builder(new zlog::LocalLoggerBuilder());
             builder->buildLoggerName("root");
             rootLogger_ = builder->build();
-            loggers_.insert({"root", rootLogger_});
+            Registry empty;
+            publish(new Registry(empty, "root", rootLogger_));
+        }
+
+        static bool isDescendant(const std::string &name, const std::string &ancestor)
+        {
+            if (ancestor == "root")
+                return true;
+            return name.size() > ancestor.size() && name[ancestor.size()] == '.' &&
+                   name.compare(0, ancestor.size(), ancestor) == 0;
+        }
+
+        // 以下函数调用者持有mutex_
+        // 沿名称层级向上查找最近的等级设置
+        LogLevel::value effectiveLevel(const std::string &name)
+        {
+            std::string cur = name;
+            while (true)
+            {
+                auto iter = levels_.find(cur);
+                if (iter != levels_.end())
+                    return iter->second;
+                size_t pos = cur.rfind('.');
+                if (pos == std::string::npos)
+                    break;
+                cur.resize(pos);
+            }
+            auto iter = levels_.find("root");
+            return iter != levels_.end() ? iter->second : LogLevel::value::DEBUG;
+        }
+
+        void applyLevel(const std::string &name, LogLevel::value level)
+        {
+            levels_[name] = level;
+            refresh(name);
+        }
+
+        // 重新计算name及其后代的有效等级
+        void refresh(const std::string &name)
+        {
+            const Registry *cur = registry_.load(std::memory_order_relaxed);
+            for (auto &entry : cur->entries_)
+            {
+                if (entry.name_ == name || isDescendant(entry.name_, name))
+                    entry.logger_->setLevel(effectiveLevel(entry.name_));
+            }
+        }
+
+        // 重新指向name及其后代中继承落地方向的日志器
+        void relink(const std::string &name)
+        {
+            const Registry *cur = registry_.load(std::memory_order_relaxed);
+            for (auto &entry : cur->entries_)
+            {
+                if (entry.logger_->inheritsSinks() && (entry.name_ == name || isDescendant(entry.name_, name)))
+                    entry.logger_->inheritSinks(sinkSource(entry.name_));
+            }
+        }
+
+        // 最近的、有自己落地方向的已注册祖先，不存在时为root
+        Logger *sinkSource(const std::string &name)
+        {
+            std::string cur = name;
+            size_t pos;
+            while ((pos = cur.rfind('.')) != std::string::npos)
+            {
+                cur.resize(pos);
+                Logger *logger = find(cur.c_str(), cur.size());
+                if (logger != nullptr && !logger->inheritsSinks())
+                    return logger;
+            }
+            return rootLogger_.get();
+        }
+
+        // 调用者持有mutex_(构造期间除外)：发布新快照，等待可能持有旧快照的读者离开后释放旧快照
+        //   读者先登记计数并确认分组未变再加载快照；新快照发布后才切换分组，切换后登记的读者只能加载到新快照，
+        //   切换前已确认的读者都计在旧分组中，写者之间由mutex_串行化，下一个写者开始前它们已全部离开
+        void publish(Registry *registry)
+        {
+            std::unique_ptr<Registry> old(std::move(current_));
+            current_.reset(registry);
+            registry_.store(registry, std::memory_order_seq_cst);
+            if (!old)
+                return;
+            uint32_t gen = readerGen_.fetch_add(1, std::memory_order_seq_cst) & 1;
+            while (readers_[gen].load(std::memory_order_acquire) != 0)
+                std::this_thread::yield();
         }
 
     private:
-        std::mutex mutex_;
+        std::mutex mutex_; // 仅用于串行化写者
         Logger::ptr rootLogger_; // 默认日志器
-        std::unordered_map<std::string, Logger::ptr> loggers_;
+        std::atomic<const Registry *> registry_;
+        std::unique_ptr<Registry> current_;  // 当前快照，旧快照在publish中释放
+        std::atomic<uint32_t> readerGen_;    // 读者分组，最低位有效
+        std::atomic<uint32_t> readers_[2];   // 各分组中正在读取的读者数
+        std::map<std::string, LogLevel::value> levels_; // 各层级显式设置的等级
+    };
+
+    /*
+        日志器句柄：首次查找成功后缓存裸指针，之后访问不再查找
+            static zlog::LoggerHandle logger("svc");
+            logger->ZLOG_INFO("...");
+    */
+    class LoggerHandle
+    {
+    public:
+        explicit LoggerHandle(const char *name)
+            : name_(name), logger_(nullptr), version_(UINT64_MAX)
+        {
+        }
+
+        // 日志器尚未注册时返回nullptr，注册表变化后会重新查找
+        Logger *get()
+        {
+            Logger *logger = logger_.load(std::memory_order_acquire);
+            if (logger != nullptr)
+                return logger;
+            return resolve();
+        }
+
+        Logger *operator->()
+        {
+            return get();
+        }
+
+        explicit operator bool()
+        {
+            return get() != nullptr;
+        }
+
+    private:
+        Logger *resolve()
+        {
+            LoggerManager &manager = LoggerManager::getInstance();
+            uint64_t version = manager.version();
+            if (version == version_.load(std::memory_order_relaxed))
+                return nullptr;
+            Logger *logger = manager.find(name_.c_str(), name_.size());
+            if (logger != nullptr)
+                logger_.store(logger, std::memory_order_release);
+            version_.store(version, std::memory_order_relaxed);
+            return logger;
+        }
+
+        std::string name_;
+        std::atomic<Logger *> logger_;
+        std::atomic<uint64_t> version_;
     };
 
     /* 全局日志器建造者 */
@@ -324,23 +1136,36 @@ namespace zlog
                 formatter_ = std::make_shared<Formatter>();
             }
 
-            if (sinks_.empty())
+            // 层级名称(含'.')且未配置落地方向时继承祖先：祖先尚未注册时暂由root落地，注册后自动改为祖先
+            //   记录交由祖先落地，自身不能有异步工作器，异步类型必须配置自己的落地方向
+            bool inherit = sinks_.empty() && strchr(loggerName_, '.') != nullptr;
+            if (inherit && loggerType_ == LoggerType::LOGGER_ASYNC)
             {
-                buildLoggerSink<StdOutSink>();
+                std::cerr << "异步日志器" << loggerName_ << "未配置落地方向，不能继承祖先的落地方向" << std::endl;
+                return Logger::ptr();
             }
+            if (sinks_.empty() && !inherit)
+                buildLoggerSink<StdOutSink>();
 
             Logger::ptr logger;
-            if (loggerType_ == LoggerType::LOGGER_ASYNC)
+            if (inherit)
+            {
+                logger = std::make_shared<SyncLogger>(loggerName_, limitLevel_, formatter_, sinks_);
+                logger->inheritSinks(LoggerManager::getInstance().rootLogger().get());
+            }
+            else if (loggerType_ == LoggerType::LOGGER_ASYNC)
             {
-                logger = std::make_shared<AsyncLogger>(loggerName_, limitLevel_, formatter_, sinks_, looperType_, milliseco_);
+                logger = std::make_shared<AsyncLogger>(loggerName_, limitLevel_, formatter_, sinks_, asyncOptions());
             }
             else
             {
                 logger = std::make_shared<SyncLogger>(loggerName_, limitLevel_, formatter_, sinks_);
             }
-            LoggerManager::getInstance().addLogger(logger);
+            if (backtraceSize_ > 0)
+                logger->enableBacktrace(backtraceSize_, backtraceLevel_);
+            LoggerManager::getInstance().addLogger(logger, levelSet_);
             return logger;
         }
     };
 
-};
+};
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
 #include "buffer.hpp"
+#include "level.hpp"
+#include "ring.hpp"
+#include "stats.hpp"
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -7,6 +10,10 @@
 #include <memory>
 #include <atomic>
 #include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
 
 namespace zlog
 {
@@ -16,30 +23,255 @@ namespace zlog
 		ASYNC_UNSAFE // 扩容缓冲区
 	};
 
+	/*后台线程与阻塞生产者的等待方式*/
+	enum class WaitStrategy
+	{
+		BLOCKING,	// 条件变量
+		SPIN,		// 忙等，独占一个CPU核心，延迟最低
+		SPIN_YIELD, // 先自旋，之后让出CPU
+		PARK		// 先自旋，之后futex睡眠；仅在对方确实睡眠时才发送唤醒
+	};
+
 	static constexpr size_t FLUSH_BUFFER_SIZE = DEFAULT_BUFFER_SIZE / 2;
+	static constexpr size_t SPIN_LIMIT = 256; // SPIN_YIELD/PARK 的自旋次数
+	static constexpr size_t URGENT_BUFFER_SIZE = 1024 * 4; // 高优先级通道初始大小，按需扩容
+	static constexpr size_t RING_NOTE_SIZE = 96;			// 飞行记录环中代替超大记录的说明行的最大长度
+
+	class AsyncBackend;
+
+	/*异步工作器配置*/
+	struct AsyncOptions
+	{
+		AsyncType looperType_ = AsyncType::ASYNC_SAFE;
+		std::chrono::milliseconds milliseco_ = std::chrono::milliseconds(3000); // 数据最长滞留时间
+		size_t bufferSize_ = DEFAULT_BUFFER_SIZE;								// 单个缓冲区初始大小，达到一半时唤醒后台
+		std::shared_ptr<AsyncBackend> backend_;									// 为空时使用独占工作线程
+		LogLevel::value priorityLevel_ = LogLevel::value::OFF;					// 不低于该等级的记录走高优先级通道，OFF表示关闭
+		std::chrono::milliseconds targetLatency_ = std::chrono::milliseconds(0);	// 目标落地延迟，非0时自适应调整批量与等待时间
+		WaitStrategy waitStrategy_ = WaitStrategy::BLOCKING;					// 独占工作线程与ASYNC_SAFE生产者的等待方式
+		ThreadOptions thread_;													// 独占工作线程的亲和性、调度策略与名称
+		int numaNode_ = -1;														// 缓冲区所在NUMA节点，-1不绑定
+		bool numaSharding_ = false;												// 每个NUMA节点一个工作器，生产者写入本节点的队列
+		size_t stageSize_ = 0;													// 生产者写合并的暂存区大小，0表示关闭
+		std::chrono::milliseconds stageDelay_ = std::chrono::milliseconds(1);	// 记录在暂存区中的最长滞留时间
+		LogLevel::value stageFlushLevel_ = LogLevel::value::WARNING;			// 不低于该等级的记录立即提交暂存区
+		std::function<void()> idleHook_;										// 后台每隔stageDelay_调用一次，不得阻塞
+		std::string ringPath_;													// 飞行记录文件，非空时未落地数据同时写入文件映射环
+		size_t ringSize_ = 0;													// 飞行记录环大小，0表示缓冲区大小的4倍
+		size_t largeRecordSize_ = 0;											// 超过该大小的记录单独存放，0表示缓冲区大小的一半，不超过缓冲区大小
+	};
+
+	/*批量落地的统计与当前决策*/
+	struct BatchStats
+	{
+		uint64_t batches_ = 0;						  // 普通通道落地批次数
+		size_t lastBatchBytes_ = 0;					  // 最近一批的数据量
+		double arrivalBytesPerSec_ = 0;				  // 到达速率(指数平均)
+		double writeNsPerByte_ = 0;					  // 大批量落地的每字节开销(指数平均)
+		double writeOverheadNs_ = 0;				  // 小批量落地的固定开销(指数平均)
+		size_t flushSize_ = 0;						  // 当前唤醒阈值
+		std::chrono::microseconds waitInterval_{0};	  // 当前最长等待时间
+		std::chrono::milliseconds targetLatency_{0}; // 目标延迟，0表示固定策略
+	};
+
+	/*
+		异步工作器：生产者写入生产缓冲区，后台交换缓冲区后回调落地
+			1. 独占模式：每个工作器一个工作线程
+			2. 共享模式：由AsyncBackend中的N个工作线程服务任意数量的工作器
+			3. 高优先级通道：pushUrgent写入独立缓冲区并立即唤醒后台，先于普通数据落地；
+			   普通数据仍按阈值与等待时间批量落地，两条通道之间不保证先后顺序
+			4. 自适应批量：配置目标延迟后，按测得的到达速率与落地开销调整唤醒阈值与等待时间
+			5. 等待策略：独占工作线程与ASYNC_SAFE生产者可选择阻塞、自旋或futex睡眠
+			   (共享模式的工作线程服务多个工作器，始终使用条件变量)
+			6. 飞行记录：写入的数据同时追加到文件映射环，落地完成后才推进环的已落地位置，
+			   进程崩溃后可由zlog-recover取回；环空间不足时生产者请求立即落地并等待
+			7. 大记录：超过largeRecordSize_的记录复制到单独分配的引用计数存储，队列中只记录它在缓冲区中的位置，
+			   落地时按位置与缓冲区数据穿插写出、之后立即释放；缓冲区既不扩容也不会因单条记录放不下而永久阻塞。
+			   ASYNC_SAFE下待落地的大记录总量不超过缓冲区大小(至少允许一条)，超出时生产者等待
+	*/
 	class AsyncLooper
 	{
 	public:
 		using Functor = std::function<void(Buffer &)>;
 		using ptr = std::shared_ptr<AsyncLooper>;
+		using Clock = std::chrono::steady_clock;
 		AsyncLooper(const Functor &func, AsyncType looperType, std::chrono::milliseconds milliseco)
-			: looperType_(looperType), stop_(false),
-			  thread_(std::thread(&AsyncLooper::threadEntry, this)), callBack_(func), milliseco_(milliseco)
+			: AsyncLooper(func, makeOptions(looperType, milliseco))
 		{
 		}
 
+		AsyncLooper(const Functor &func, const AsyncOptions &options)
+			: looperType_(options.looperType_), stop_(false),
+			  proBuf_(options.bufferSize_), conBuf_(options.bufferSize_),
+			  urgentBuf_(URGENT_BUFFER_SIZE), conUrgent_(URGENT_BUFFER_SIZE),
+			  callBack_(func), milliseco_(options.milliseco_),
+			  flushSize_(std::max<size_t>(options.bufferSize_ / 2, 1)), maxFlushSize_(flushSize_.load()),
+			  targetLatency_(options.targetLatency_),
+			  waitNs_(std::chrono::duration_cast<std::chrono::nanoseconds>(
+						  targetLatency_.count() > 0 ? targetLatency_ : milliseco_)
+						  .count()),
+			  lastSwap_(Clock::now()),
+			  enqueued_(0), written_(0), drainRequests_(0),
+			  strategy_(options.waitStrategy_), parked_(false), wakeSeq_(0), swapSeq_(0), parkedProducers_(0),
+			  backend_(options.backend_), pending_(0), deadline_(0), urgent_(false), serving_(false),
+			  idleHook_(options.idleHook_),
+			  idlePeriod_(std::chrono::duration_cast<Clock::duration>(options.stageDelay_).count()),
+			  idleDue_(Clock::now().time_since_epoch().count() + idlePeriod_),
+			  largeSize_(std::min(options.largeRecordSize_ > 0 ? options.largeRecordSize_ : options.bufferSize_ / 2,
+								  options.bufferSize_)),
+			  largeLimit_(options.bufferSize_), largeBytes_(0)
+		{
+			if (!options.ringPath_.empty())
+			{
+				size_t ringSize = std::max(options.ringSize_ > 0 ? options.ringSize_ : options.bufferSize_ * 4, RING_NOTE_SIZE);
+				ring_.reset(new MmapRing(options.ringPath_, ringSize));
+				if (!ring_->valid())
+					ring_.reset();
+			}
+			if (options.numaNode_ >= 0)
+			{
+				proBuf_.bindNode(options.numaNode_);
+				conBuf_.bindNode(options.numaNode_);
+				urgentBuf_.bindNode(options.numaNode_);
+				conUrgent_.bindNode(options.numaNode_);
+			}
+			// 所有成员初始化完毕后再启动工作线程
+			if (backend_)
+				attach();
+			else
+				thread_ = std::thread(&AsyncLooper::threadEntry, this, options.thread_);
+		}
+
 		void push(const char *data, size_t len)
+		{
+			if (len > largeSize_)
+			{
+				pushLarge(data, len, false, true);
+				return;
+			}
+			bool wake = false;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				if (!bufferFits(len) || !ringFits(len))
+				{
+					// 记录生产者被阻塞的次数与时长
+					auto begin = Clock::now();
+					// 两种等待都会释放锁，期间其他生产者可能再次占满，必须在同一次持锁时同时满足
+					while (!bufferFits(len) || !ringFits(len))
+					{
+						if (!bufferFits(len))
+							waitForSpace(lock, len);
+						else
+							waitForRing(lock, len);
+					}
+					metrics_.blocked_.add();
+					metrics_.blockNs_.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+				}
+				wake = pushLocked(data, len);
+			}
+			if (wake)
+				wakeConsumer();
+		}
+
+		// 不等待的写入：ASYNC_SAFE缓冲区空间不足时返回false，可在后台线程中调用
+		bool tryPush(const char *data, size_t len)
+		{
+			if (len > largeSize_)
+				return pushLarge(data, len, false, false);
+			bool wake = false;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				if (!bufferFits(len) || !ringFits(len))
+					return false;
+				wake = pushLocked(data, len);
+			}
+			if (wake)
+				wakeConsumer();
+			return true;
+		}
+
+		// 高优先级通道：不受固定缓冲区限制，立即唤醒后台
+		void pushUrgent(const char *data, size_t len)
+		{
+			if (len > largeSize_)
+			{
+				pushLarge(data, len, true, true);
+				return;
+			}
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				if (!ringFits(len))
+					waitForRing(lock, len);
+				urgentBuf_.push(data, len);
+				journal(data, len);
+				enqueued_++;
+				urgent_.store(true, std::memory_order_seq_cst);
+			}
+			wakeConsumer();
+		}
+
+		// 阻塞直到调用前写入的所有数据(两条通道)均已落地
+		void drain()
 		{
 			std::unique_lock<std::mutex> lock(mutex_);
-			if (looperType_ == AsyncType::ASYNC_SAFE)
+			uint64_t target = enqueued_;
+			if (written_ >= target)
+				return;
+			drainRequests_++;
+			urgent_.store(true, std::memory_order_seq_cst);
+			lock.unlock();
+			wakeConsumer();
+			lock.lock();
+			condDone_.wait(lock, [&]()
+						   { return written_ >= target; });
+		}
+
+		// 不等待的drain：调用前写入的所有数据落地后在后台线程调用done
+		void flush(const std::function<void()> &done)
+		{
 			{
-				condPro_.wait(lock, [&]()
-							  { return proBuf_.writeAbleSize() >= len; });
+				std::unique_lock<std::mutex> lock(mutex_);
+				uint64_t target = enqueued_;
+				if (written_ < target)
+				{
+					flushWaiters_.push_back(std::make_pair(target, done));
+					drainRequests_++;
+					urgent_.store(true, std::memory_order_seq_cst);
+					lock.unlock();
+					wakeConsumer();
+					return;
+				}
 			}
-			proBuf_.push(data, len);
+			done();
+		}
 
-			if (proBuf_.readAbleSize() >= FLUSH_BUFFER_SIZE)
-				condCon_.notify_one();
+		// 运行时统计快照
+		LooperSnapshot snapshot()
+		{
+			LooperSnapshot snap;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				snap.pendingBytes_ = proBuf_.readAbleSize() + urgentBuf_.readAbleSize() + largeBytes_;
+				snap.bufferCapacity_ = proBuf_.capacity();
+				snap.enqueued_ = enqueued_;
+				snap.written_ = written_;
+			}
+			snap.blocked_ = metrics_.blocked_.value();
+			snap.growths_ = metrics_.growths_.value();
+			snap.largeRecords_ = metrics_.large_.value();
+			snap.blockNs_ = metrics_.blockNs_.snapshot();
+			snap.batchBytes_ = metrics_.batchBytes_.snapshot();
+			return snap;
+		}
+
+		BatchStats batchStats()
+		{
+			std::unique_lock<std::mutex> lock(statsMutex_);
+			BatchStats stats = stats_;
+			stats.flushSize_ = flushSize();
+			stats.waitInterval_ = std::chrono::duration_cast<std::chrono::microseconds>(waitInterval());
+			stats.targetLatency_ = targetLatency_;
+			return stats;
 		}
 
 		~AsyncLooper()
@@ -49,44 +281,531 @@ namespace zlog
 
 		void stop()
 		{
-			stop_ = true;
-			condCon_.notify_all();
-			thread_.join(); // 等待工作线程退出
+			if (stop_.exchange(true))
+				return;
+			if (backend_)
+			{
+				// 脱离线程池后由当前线程落地剩余数据
+				detach();
+				while (serve(true))
+					;
+			}
+			else
+			{
+				{
+					std::unique_lock<std::mutex> lock(mutex_); // 与工作线程的等待判断串行，避免丢失唤醒
+				}
+				condCon_.notify_all();
+				wakeSeq_++;
+				Futex::wakeOne(wakeSeq_);
+				thread_.join(); // 等待工作线程退出
+			}
+			if (ring_)
+				ring_->close();
 		}
 
 	private:
+		friend class AsyncBackend;
+
+		// 大记录
+		struct LargeRecord
+		{
+			size_t offset_;				  // 写入时通道缓冲区中已有的数据量，落地时在此处穿插
+			std::shared_ptr<Buffer> data_; // 单独分配的存储，落地后释放
+		};
+
+		static AsyncOptions makeOptions(AsyncType looperType, std::chrono::milliseconds milliseco)
+		{
+			AsyncOptions options;
+			options.looperType_ = looperType;
+			options.milliseco_ = milliseco;
+			return options;
+		}
+
+		void attach();
+		void detach();
+		void notifyBackend();
+
+		// 调用者持有mutex_且已确认空间足够，返回是否需要唤醒后台
+		bool pushLocked(const char *data, size_t len)
+		{
+			size_t before = proBuf_.readAbleSize();
+			size_t capacity = proBuf_.capacity();
+			proBuf_.push(data, len);
+			if (proBuf_.capacity() != capacity)
+				metrics_.growths_.add();
+			journal(data, len);
+			size_t after = proBuf_.readAbleSize();
+			enqueued_++;
+
+			// 缓冲区由空变为非空时确定本批数据的落地期限
+			if (before == 0)
+				deadline_.store((Clock::now() + waitInterval()).time_since_epoch().count(), std::memory_order_relaxed);
+			pending_.store(after, std::memory_order_seq_cst);
+			// 仅在跨过阈值时唤醒；共享模式在新批次开始时也需唤醒，以便线程池重新计算睡眠时间
+			return (before < flushSize() && after >= flushSize()) || (backend_ && before == 0);
+		}
+
+		// 大记录：在锁外复制到单独的存储，队列中只保存指针及其在通道缓冲区中的位置，落地后释放
+		//   block为false时不等待，ASYNC_SAFE待落地大记录超限或飞行记录环空间不足时返回false
+		bool pushLarge(const char *data, size_t len, bool urgent, bool block)
+		{
+			std::shared_ptr<Buffer> record = std::make_shared<Buffer>(len);
+			record->push(data, len);
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				auto over = [&]()
+				{ return !urgent && looperType_ == AsyncType::ASYNC_SAFE && largeOverLimit(len); };
+				if (over() || !ringFits(len))
+				{
+					if (!block)
+						return false;
+					auto begin = Clock::now();
+					while (over() || !ringFits(len))
+					{
+						if (over())
+							condPro_.wait(lock);
+						else
+							waitForRing(lock, len);
+					}
+					metrics_.blocked_.add();
+					metrics_.blockNs_.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+				}
+				if (urgent)
+					largeUrgent_.push_back({urgentBuf_.readAbleSize(), record});
+				else
+					large_.push_back({proBuf_.readAbleSize(), record});
+				largeBytes_ += len;
+				journal(data, len);
+				enqueued_++;
+				metrics_.large_.add();
+				// 大记录不等待批量，立即落地以尽快释放
+				urgent_.store(true, std::memory_order_seq_cst);
+			}
+			wakeConsumer();
+			return true;
+		}
+
+		// 调用者持有mutex_：再加入len字节的大记录是否超出待落地总量限制
+		bool largeOverLimit(size_t len) const
+		{
+			return largeBytes_ > 0 && largeBytes_ + len > largeLimit_;
+		}
+
+		// 按写入顺序落地通道缓冲区及穿插其中的大记录，之后清空二者；返回大记录的字节数
+		size_t deliver(Buffer &buffer, std::vector<LargeRecord> &large)
+		{
+			size_t largeBytes = 0;
+			size_t done = 0; // 已落地的缓冲区数据量
+			for (auto &record : large)
+			{
+				if (record.offset_ > done)
+				{
+					size_t hidden = buffer.shrinkReadable(record.offset_ - done);
+					callBack_(buffer);
+					buffer.moveReader(buffer.readAbleSize());
+					buffer.extendReadable(hidden);
+					done = record.offset_;
+				}
+				callBack_(*record.data_);
+				largeBytes += record.data_->readAbleSize();
+			}
+			if (!buffer.empty())
+				callBack_(buffer);
+			buffer.reset();
+			large.clear(); // 释放大记录的存储
+			return largeBytes;
+		}
+
+		// 调用者持有mutex_：在锁外调用已完成的flush回调
+		void completeFlush(std::unique_lock<std::mutex> &lock)
+		{
+			std::vector<std::function<void()>> done;
+			for (auto iter = flushWaiters_.begin(); iter != flushWaiters_.end();)
+			{
+				if (iter->first <= written_)
+				{
+					done.push_back(std::move(iter->second));
+					iter = flushWaiters_.erase(iter);
+				}
+				else
+				{
+					++iter;
+				}
+			}
+			lock.unlock();
+			for (auto &func : done)
+				func();
+			lock.lock();
+		}
+
+		// 调用者持有mutex_：ASYNC_SAFE的固定缓冲区能否写入len字节
+		bool bufferFits(size_t len)
+		{
+			return looperType_ != AsyncType::ASYNC_SAFE || proBuf_.writeAbleSize() >= len;
+		}
+
+		// len字节的记录在飞行记录环中占用的空间：超过环容量的记录以一行说明代替
+		size_t ringNeed(size_t len) const
+		{
+			return len <= ring_->capacity() ? len : RING_NOTE_SIZE;
+		}
+
+		// 调用者持有mutex_：飞行记录环能否写入len字节的记录
+		bool ringFits(size_t len) const
+		{
+			return !ring_ || ring_->writable() >= ringNeed(len);
+		}
+
+		// 调用者持有mutex_且已确认ringFits：写入飞行记录环
+		//   超过环容量的记录无法保留，写入一行说明，恢复时可知此处缺少一条记录
+		void journal(const char *data, size_t len)
+		{
+			if (!ring_)
+				return;
+			if (len <= ring_->capacity())
+			{
+				ring_->append(data, len);
+				return;
+			}
+			char note[RING_NOTE_SIZE];
+			int n = snprintf(note, sizeof(note), "zlog: %zu-byte record too large for flight recorder\n", len);
+			ring_->append(note, std::min(static_cast<size_t>(n), sizeof(note) - 1));
+		}
+
+		// 调用者持有mutex_：请求立即落地并等待环中腾出空间
+		void waitForRing(std::unique_lock<std::mutex> &lock, size_t len)
+		{
+			size_t need = ringNeed(len);
+			while (ring_->writable() < need)
+			{
+				drainRequests_++;
+				urgent_.store(true, std::memory_order_seq_cst);
+				lock.unlock();
+				wakeConsumer();
+				lock.lock();
+				condPro_.wait_for(lock, waitInterval(), [&]()
+								  { return ring_->writable() >= need; });
+			}
+		}
+
+		bool idleDue(Clock::time_point now) const
+		{
+			return idleHook_ && now.time_since_epoch().count() >= idleDue_.load(std::memory_order_relaxed);
+		}
+
+		// 到期时调用空闲钩子，仅由服务线程调用
+		void runIdleHook()
+		{
+			auto now = Clock::now();
+			if (!idleDue(now))
+				return;
+			idleDue_.store(now.time_since_epoch().count() + idlePeriod_, std::memory_order_relaxed);
+			idleHook_();
+		}
+
+		// 唤醒后台：共享模式通知线程池，独占模式按等待策略；调用者不持有mutex_
+		void wakeConsumer()
+		{
+			if (backend_)
+			{
+				notifyBackend();
+				return;
+			}
+			switch (strategy_)
+			{
+			case WaitStrategy::BLOCKING:
+				condCon_.notify_one();
+				break;
+			case WaitStrategy::PARK:
+				if (parked_.load(std::memory_order_seq_cst))
+				{
+					wakeSeq_.fetch_add(1, std::memory_order_seq_cst);
+					Futex::wakeOne(wakeSeq_);
+				}
+				break;
+			default:
+				break; // 自旋中的工作线程自行发现数据
+			}
+		}
+
+		// ASYNC_SAFE生产者等待缓冲区交换，调用者持有mutex_
+		void waitForSpace(std::unique_lock<std::mutex> &lock, size_t len)
+		{
+			if (strategy_ == WaitStrategy::BLOCKING)
+			{
+				condPro_.wait(lock, [&]()
+							  { return proBuf_.writeAbleSize() >= len; });
+				return;
+			}
+			while (proBuf_.writeAbleSize() < len)
+			{
+				uint32_t seq = swapSeq_.load(std::memory_order_seq_cst);
+				lock.unlock();
+				for (size_t spins = 0; swapSeq_.load(std::memory_order_acquire) == seq; ++spins)
+				{
+					if (strategy_ == WaitStrategy::SPIN || spins < SPIN_LIMIT)
+					{
+						cpuRelax();
+					}
+					else if (strategy_ == WaitStrategy::SPIN_YIELD)
+					{
+						std::this_thread::yield();
+					}
+					else
+					{
+						parkedProducers_.fetch_add(1, std::memory_order_seq_cst);
+						if (swapSeq_.load(std::memory_order_seq_cst) == seq)
+							Futex::wait(swapSeq_, seq, waitInterval());
+						parkedProducers_.fetch_sub(1, std::memory_order_seq_cst);
+					}
+				}
+				lock.lock();
+			}
+		}
+
+		// 交换缓冲区后唤醒等待空间的生产者，调用者持有mutex_
+		void wakeProducers()
+		{
+			swapSeq_.fetch_add(1, std::memory_order_seq_cst);
+			if (strategy_ == WaitStrategy::BLOCKING)
+				condPro_.notify_all();
+			else if (strategy_ == WaitStrategy::PARK && parkedProducers_.load(std::memory_order_seq_cst) > 0)
+				Futex::wakeAll(swapSeq_);
+		}
+
+		// 独占模式无锁判断：是否有需要立即处理的数据
+		bool workReady() const
+		{
+			return urgent_.load(std::memory_order_seq_cst) ||
+				   pending_.load(std::memory_order_seq_cst) >= flushSize() || stop_;
+		}
+
+		// 非阻塞策略下独占工作线程的等待，返回是否因超时返回
+		bool waitForWork()
+		{
+			for (size_t spins = 0;; ++spins)
+			{
+				if (workReady())
+					return false;
+				// 每隔一段时间检查当前批次是否到期
+				if ((spins & 63) == 0)
+				{
+					auto now = Clock::now();
+					if (pending_.load(std::memory_order_acquire) > 0 &&
+						now.time_since_epoch().count() >= deadline_.load(std::memory_order_relaxed))
+						return true;
+					if (idleDue(now))
+						return false;
+				}
+
+				if (strategy_ == WaitStrategy::SPIN || spins < SPIN_LIMIT)
+				{
+					cpuRelax();
+				}
+				else if (strategy_ == WaitStrategy::SPIN_YIELD)
+				{
+					std::this_thread::yield();
+				}
+				else
+				{
+					// 先声明睡眠再复查，与生产者的"写入数据后检查parked_"配对，避免丢失唤醒
+					uint32_t seq = wakeSeq_.load(std::memory_order_seq_cst);
+					parked_.store(true, std::memory_order_seq_cst);
+					if (!workReady())
+					{
+						auto timeout = waitInterval();
+						if (pending_.load(std::memory_order_acquire) > 0)
+						{
+							auto left = Clock::duration(deadline_.load(std::memory_order_relaxed)) - Clock::now().time_since_epoch();
+							timeout = std::max(std::chrono::duration_cast<std::chrono::nanoseconds>(left), std::chrono::nanoseconds(0));
+						}
+						if (idleHook_)
+						{
+							auto left = Clock::duration(idleDue_.load(std::memory_order_relaxed)) - Clock::now().time_since_epoch();
+							timeout = std::min(timeout, std::max(std::chrono::duration_cast<std::chrono::nanoseconds>(left), std::chrono::nanoseconds(0)));
+						}
+						Futex::wait(wakeSeq_, seq, timeout);
+					}
+					parked_.store(false, std::memory_order_relaxed);
+					spins = 0;
+				}
+			}
+		}
+
+		// 共享模式：无锁判断是否需要服务
+		bool ready(Clock::time_point now) const
+		{
+			if (urgent_.load(std::memory_order_acquire) || idleDue(now))
+				return true;
+			size_t pending = pending_.load(std::memory_order_acquire);
+			if (pending == 0)
+				return false;
+			return pending >= flushSize() || now.time_since_epoch().count() >= deadline_.load(std::memory_order_relaxed);
+		}
+
+		size_t flushSize() const
+		{
+			return flushSize_.load(std::memory_order_relaxed);
+		}
+
+		std::chrono::nanoseconds waitInterval() const
+		{
+			return std::chrono::nanoseconds(waitNs_.load(std::memory_order_relaxed));
+		}
+
+		// 每批普通数据落地后更新统计；配置了目标延迟时重新计算决策
+		//   落地开销 = 固定开销 + 每字节开销 * 数据量，小批量只用于估计固定开销
+		//   落地预算为目标延迟的一半：阈值 = 预算 / 每字节开销，限制单批写出时间
+		//   等待时间 = 目标延迟 - 预计一批数据的写出时间，保证空闲时数据也能在目标内可见
+		void adapt(size_t bytes, Clock::time_point begin, Clock::time_point end)
+		{
+			static constexpr double kAlpha = 0.2;		 // 指数平均权重
+			static constexpr size_t kMinFlushSize = 4096; // 阈值下限，避免过于频繁地唤醒
+			double elapsedSec = std::chrono::duration<double>(begin - lastSwap_).count();
+			double writeNs = std::chrono::duration<double, std::nano>(end - begin).count();
+			lastSwap_ = begin;
+
+			std::unique_lock<std::mutex> lock(statsMutex_);
+			stats_.batches_++;
+			stats_.lastBatchBytes_ = bytes;
+			if (bytes == 0)
+				return;
+			double rate = elapsedSec > 0 ? bytes / elapsedSec : stats_.arrivalBytesPerSec_;
+			stats_.arrivalBytesPerSec_ = ewma(stats_.arrivalBytesPerSec_, rate, kAlpha);
+			if (bytes >= kMinFlushSize)
+				stats_.writeNsPerByte_ = ewma(stats_.writeNsPerByte_, writeNs / bytes, kAlpha);
+			else
+				stats_.writeOverheadNs_ = ewma(stats_.writeOverheadNs_, writeNs, kAlpha);
+			if (targetLatency_.count() == 0)
+				return;
+
+			double targetNs = std::chrono::duration<double, std::nano>(targetLatency_).count();
+			double perByte = std::max(stats_.writeNsPerByte_, 1e-3);
+			double budget = std::max(targetNs / 2 - stats_.writeOverheadNs_, 0.0);
+			double maxBatch = std::min<double>(budget / perByte, static_cast<double>(maxFlushSize_));
+			size_t flush = std::max<size_t>(static_cast<size_t>(maxBatch), std::min(kMinFlushSize, maxFlushSize_));
+			double expected = std::min(stats_.arrivalBytesPerSec_ * targetNs / 1e9, static_cast<double>(flush));
+			double waitNs = std::max(targetNs - stats_.writeOverheadNs_ - expected * perByte, 1e6);
+			flushSize_.store(flush, std::memory_order_relaxed);
+			waitNs_.store(static_cast<int64_t>(waitNs), std::memory_order_relaxed);
+		}
+
+		static double ewma(double old, double sample, double alpha)
+		{
+			return old == 0 ? sample : alpha * sample + (1 - alpha) * old;
+		}
+
+		// 交换缓冲区并落地，两种模式共用；同一时刻只有一个线程调用
+		// 高优先级数据总是先落地；普通数据在超时、达到阈值、停止或有drain请求时落地；返回是否有进展
+		bool serve(bool timedOut)
+		{
+			bool full = false;
+			uint64_t seq = 0;
+			uint64_t ringPos = 0;
+			if (idleHook_)
+				runIdleHook();
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				urgent_.store(false, std::memory_order_relaxed);
+				if (backend_)
+					timedOut = timedOut || Clock::now().time_since_epoch().count() >= deadline_.load(std::memory_order_relaxed);
+				full = timedOut || stop_ || drainRequests_ > 0 || proBuf_.readAbleSize() >= flushSize() || !large_.empty();
+				if (!full && urgentBuf_.empty() && largeUrgent_.empty())
+					return false;
+				if (proBuf_.empty() && urgentBuf_.empty() && large_.empty() && largeUrgent_.empty() && drainRequests_ == 0)
+					return false;
+
+				conUrgent_.swap(urgentBuf_);
+				conLargeUrgent_.swap(largeUrgent_);
+				if (full)
+				{
+					conBuf_.swap(proBuf_);
+					conLarge_.swap(large_);
+					seq = enqueued_;
+					if (ring_)
+						ringPos = ring_->committed();
+					drainRequests_ = 0;
+					pending_.store(0, std::memory_order_release);
+					if (looperType_ == AsyncType::ASYNC_SAFE)
+						wakeProducers();
+				}
+			}
+
+			size_t released = deliver(conUrgent_, conLargeUrgent_);
+			if (full)
+			{
+				size_t bytes = conBuf_.readAbleSize();
+				auto begin = Clock::now();
+				size_t large = deliver(conBuf_, conLarge_);
+				bytes += large;
+				released += large;
+				metrics_.batchBytes_.record(bytes);
+				adapt(bytes, begin, Clock::now());
+			}
+			if (released > 0 || full)
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				if (released > 0)
+				{
+					// 大记录的存储已释放，唤醒等待的生产者
+					largeBytes_ -= released;
+					condPro_.notify_all();
+				}
+				if (!full)
+					return true;
+				written_ = std::max(written_, seq);
+				condDone_.notify_all();
+				// 交换前提交的数据(两条通道)均已落地
+				if (ring_)
+				{
+					ring_->release(ringPos);
+					condPro_.notify_all();
+				}
+				if (!flushWaiters_.empty())
+					completeFlush(lock);
+			}
+			return true;
+		}
+
 		// 线程入口函数--对消费缓冲区中的数据进行处理，处理完毕后，初始化缓冲区，交换缓冲区
-		void threadEntry()
+		void threadEntry(ThreadOptions options)
 		{
+			Thread::apply(options);
 			while (true)
 			{
+				bool timedOut = false;
 				{
 					// 1.判断生产缓冲区有没有数据
 					std::unique_lock<std::mutex> lock(mutex_);
 
 					// 当生产缓冲区为空且标志位被设置的情况下菜退出，否则退出时生产缓冲区仍有数据
-					if (proBuf_.empty() && stop_ == true)
+					if (proBuf_.empty() && urgentBuf_.empty() && large_.empty() && largeUrgent_.empty() && stop_ == true)
 					{
 						break;
 					}
 
 					// 等待，超时返回
-					if (!condCon_.wait_for(lock, milliseco_, [this]()
-										   { return proBuf_.readAbleSize() >= FLUSH_BUFFER_SIZE || stop_; }))
+					if (strategy_ == WaitStrategy::BLOCKING)
 					{
-						if (proBuf_.empty())
-							continue;
+						// 有空闲钩子时按钩子周期醒来，仅在当前批次到期时才视为超时
+						auto wait = idleHook_ ? std::min(waitInterval(), std::chrono::nanoseconds(idlePeriod_)) : waitInterval();
+						timedOut = !condCon_.wait_for(lock, wait, [this]()
+													  { return !urgentBuf_.empty() || drainRequests_ > 0 || !large_.empty() || !largeUrgent_.empty() ||
+															   proBuf_.readAbleSize() >= flushSize() || stop_; });
+						if (timedOut && idleHook_)
+							timedOut = pending_.load(std::memory_order_relaxed) > 0 &&
+									   Clock::now().time_since_epoch().count() >= deadline_.load(std::memory_order_relaxed);
+					}
+					else
+					{
+						lock.unlock();
+						timedOut = waitForWork();
 					}
-
-					// 2.唤醒后交换缓冲区
-					conBuf_.swap(proBuf_);
-					if (looperType_ == AsyncType::ASYNC_SAFE)
-						condPro_.notify_one();
 				}
 
-				// 3.处理数据并初始化
-				callBack_(conBuf_);
-				conBuf_.reset();
+				// 2.交换缓冲区，处理数据并初始化
+				serve(timedOut);
 			}
 		}
 
@@ -95,11 +814,225 @@ namespace zlog
 		std::atomic<bool> stop_; // 是否工作
 		Buffer proBuf_;			 // 生产缓冲区
 		Buffer conBuf_;			 // 消费缓冲区
+		Buffer urgentBuf_;		 // 高优先级生产缓冲区
+		Buffer conUrgent_;		 // 高优先级消费缓冲区
 		std::mutex mutex_;
 		std::condition_variable condPro_;
 		std::condition_variable condCon_;
+		std::condition_variable condDone_; // drain等待落地完成
 		std::thread thread_;				  // 工作线程
 		Functor callBack_;					  // 回调函数
 		std::chrono::milliseconds milliseco_; // 最大等待时间--毫秒
+		std::atomic<size_t> flushSize_;		  // 唤醒后台的数据量
+		size_t maxFlushSize_;				  // 唤醒阈值上限(缓冲区的一半)
+		std::chrono::milliseconds targetLatency_;
+		std::atomic<int64_t> waitNs_;		  // 最长等待时间，未配置目标延迟时等于milliseco_
+		Clock::time_point lastSwap_;		  // 上一批普通数据开始落地的时间，仅消费方访问
+		std::mutex statsMutex_;
+		BatchStats stats_;
+		LooperStats metrics_;				  // 运行时统计
+		uint64_t enqueued_;					  // 已写入的记录数
+		uint64_t written_;					  // 已落地的记录数(两条通道均已清空时更新)
+		uint64_t drainRequests_;			  // 等待中的drain请求
+		std::vector<std::pair<uint64_t, std::function<void()>>> flushWaiters_; // 等待落地的flush回调及其目标记录数
+
+		// 等待策略
+		WaitStrategy strategy_;
+		std::atomic<bool> parked_;				  // 独占工作线程是否在futex上睡眠
+		std::atomic<uint32_t> wakeSeq_;			  // 唤醒工作线程的futex字
+		std::atomic<uint32_t> swapSeq_;			  // 缓冲区交换次数，阻塞生产者的futex字
+		std::atomic<uint32_t> parkedProducers_; // 在futex上睡眠的生产者数量
+
+		// 共享模式
+		std::shared_ptr<AsyncBackend> backend_;
+		std::atomic<size_t> pending_;	// 生产缓冲区数据量
+		std::atomic<int64_t> deadline_; // 当前批次的落地期限(steady_clock计数)
+		std::atomic<bool> urgent_;		// 有高优先级数据或drain请求
+		bool serving_;					// 是否正被某个工作线程服务，由AsyncBackend::mutex_保护
+
+		// 空闲钩子：生产者写合并借此回收滞留的暂存区
+		std::function<void()> idleHook_;
+		int64_t idlePeriod_;			 // 调用周期(steady_clock计数)
+		std::atomic<int64_t> idleDue_; // 下一次调用时间
+
+		std::unique_ptr<MmapRing> ring_; // 飞行记录环，未开启时为空
+
+		// 大记录
+		size_t largeSize_;						// 超过该大小的记录单独存放
+		size_t largeLimit_;						// ASYNC_SAFE下待落地大记录的总量上限
+		size_t largeBytes_;						// 待落地大记录的总量，由mutex_保护
+		std::vector<LargeRecord> large_;		// 普通通道
+		std::vector<LargeRecord> conLarge_;
+		std::vector<LargeRecord> largeUrgent_;	// 高优先级通道
+		std::vector<LargeRecord> conLargeUrgent_;
+	};
+
+	/*
+		共享后台线程池：N个工作线程轮转服务所有挂载的工作器
+			1. 同一工作器同一时刻只由一个线程服务，保证落地顺序
+			2. 从上次服务位置之后开始挑选，避免繁忙的工作器饿死其他工作器
+			3. 没有可服务的工作器时睡眠到最近的落地期限或被生产者唤醒
+	*/
+	class AsyncBackend
+	{
+	public:
+		using ptr = std::shared_ptr<AsyncBackend>;
+		// options应用到每个工作线程，名称追加序号
+		explicit AsyncBackend(size_t threadNum = 1, const ThreadOptions &options = ThreadOptions())
+			: stop_(false), notified_(false), cursor_(0)
+		{
+			threadNum = std::max<size_t>(threadNum, 1);
+			for (size_t i = 0; i < threadNum; ++i)
+			{
+				ThreadOptions worker = options;
+				if (!worker.name_.empty())
+					worker.name_ += "-" + std::to_string(i);
+				workers_.emplace_back(&AsyncBackend::workerEntry, this, worker);
+			}
+		}
+
+		~AsyncBackend()
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				stop_ = true;
+			}
+			cond_.notify_all();
+			for (auto &worker : workers_)
+				worker.join();
+		}
+
+		AsyncBackend(const AsyncBackend &) = delete;
+		AsyncBackend &operator=(const AsyncBackend &) = delete;
+
+		size_t threadCount() const
+		{
+			return workers_.size();
+		}
+
+	private:
+		friend class AsyncLooper;
+
+		// 唤醒工作线程，按新工作器重新计算睡眠时间
+		void attach(AsyncLooper *looper)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				loopers_.push_back(looper);
+				notified_ = true;
+			}
+			cond_.notify_all();
+		}
+
+		// 等待正在进行的服务结束后移除
+		void detach(AsyncLooper *looper)
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			idle_.wait(lock, [&]()
+					   { return !looper->serving_; });
+			auto iter = std::find(loopers_.begin(), loopers_.end(), looper);
+			if (iter != loopers_.end())
+			{
+				size_t idx = iter - loopers_.begin();
+				loopers_.erase(iter);
+				if (cursor_ > idx)
+					cursor_--;
+			}
+		}
+
+		void notify()
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				notified_ = true;
+			}
+			cond_.notify_one();
+		}
+
+		// 调用者持有mutex_：挑选下一个需要服务且空闲的工作器
+		AsyncLooper *pick(AsyncLooper::Clock::time_point now)
+		{
+			size_t n = loopers_.size();
+			for (size_t i = 0; i < n; ++i)
+			{
+				size_t idx = (cursor_ + i) % n;
+				AsyncLooper *looper = loopers_[idx];
+				if (!looper->serving_ && looper->ready(now))
+				{
+					cursor_ = (idx + 1) % n;
+					looper->serving_ = true;
+					return looper;
+				}
+			}
+			return nullptr;
+		}
+
+		// 调用者持有mutex_：最近的落地期限
+		AsyncLooper::Clock::time_point nextDeadline(AsyncLooper::Clock::time_point now)
+		{
+			auto next = now + std::chrono::seconds(1);
+			for (auto looper : loopers_)
+			{
+				if (looper->serving_)
+					continue;
+				if (looper->idleHook_)
+					next = std::min(next, AsyncLooper::Clock::time_point(AsyncLooper::Clock::duration(looper->idleDue_.load(std::memory_order_relaxed))));
+				if (looper->pending_.load(std::memory_order_acquire) == 0)
+					continue;
+				AsyncLooper::Clock::time_point deadline(AsyncLooper::Clock::duration(looper->deadline_.load(std::memory_order_relaxed)));
+				next = std::min(next, deadline);
+			}
+			return next;
+		}
+
+		void workerEntry(ThreadOptions options)
+		{
+			Thread::apply(options);
+			std::unique_lock<std::mutex> lock(mutex_);
+			while (!stop_)
+			{
+				auto now = AsyncLooper::Clock::now();
+				AsyncLooper *looper = pick(now);
+				if (looper == nullptr)
+				{
+					if (!notified_)
+						cond_.wait_until(lock, nextDeadline(now));
+					notified_ = false;
+					continue;
+				}
+
+				lock.unlock();
+				looper->serve(false);
+				lock.lock();
+
+				looper->serving_ = false;
+				idle_.notify_all(); // 唤醒可能在等待detach的线程
+			}
+		}
+
+	private:
+		std::mutex mutex_;
+		std::condition_variable cond_; // 工作线程等待任务
+		std::condition_variable idle_; // detach等待服务结束
+		bool stop_;
+		bool notified_; // 睡眠前是否有新的唤醒请求
+		size_t cursor_; // 轮转起点
+		std::vector<AsyncLooper *> loopers_;
+		std::vector<std::thread> workers_;
 	};
-};
\ No newline at end of file
+
+	inline void AsyncLooper::attach()
+	{
+		backend_->attach(this);
+	}
+
+	inline void AsyncLooper::detach()
+	{
+		backend_->detach(this);
+	}
+
+	inline void AsyncLooper::notifyBackend()
+	{
+		backend_->notify();
+	}
+};
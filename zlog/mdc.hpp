@@ -0,0 +1,135 @@
+#pragma once
+#include "escape.hpp"
+#include <string>
+#include <vector>
+#include <utility>
+
+/*
+    线程局部的诊断上下文(MDC)
+        1. put/remove 修改当前线程的上下文字段，Scope 在作用域结束时恢复旧值
+        2. 上下文在修改时渲染一次为 key=value 字节串，格式化时直接拷贝
+        3. 通过格式化字符 %X 输出全部字段，%X{key} 输出单个字段
+*/
+namespace zlog
+{
+    class MDC
+    {
+    public:
+        // 设置字段，已存在则覆盖
+        static void put(const std::string &key, const std::string &value)
+        {
+            Context &ctx = current();
+            Entry *entry = ctx.find(key.c_str());
+            if (entry != nullptr)
+                entry->second = value;
+            else
+                ctx.entries_.push_back({key, value});
+            ctx.render();
+        }
+
+        static void remove(const std::string &key)
+        {
+            Context &ctx = current();
+            for (auto iter = ctx.entries_.begin(); iter != ctx.entries_.end(); ++iter)
+            {
+                if (iter->first == key)
+                {
+                    ctx.entries_.erase(iter);
+                    ctx.render();
+                    return;
+                }
+            }
+        }
+
+        static void clear()
+        {
+            Context &ctx = current();
+            ctx.entries_.clear();
+            ctx.render();
+        }
+
+        // 查找字段取值，不存在返回nullptr
+        static const std::string *get(const char *key)
+        {
+            Entry *entry = current().find(key);
+            return entry == nullptr ? nullptr : &entry->second;
+        }
+
+        // 预渲染的全部字段：key=value key=value
+        static const std::string &rendered()
+        {
+            return current().rendered_;
+        }
+
+        // 作用域字段：构造时压入，析构时恢复进入作用域前的状态
+        class Scope
+        {
+        public:
+            Scope(const std::string &key, const std::string &value)
+                : key_(key)
+            {
+                const std::string *old = MDC::get(key_.c_str());
+                hadOld_ = old != nullptr;
+                if (hadOld_)
+                    old_ = *old;
+                MDC::put(key_, value);
+            }
+
+            ~Scope()
+            {
+                if (hadOld_)
+                    MDC::put(key_, old_);
+                else
+                    MDC::remove(key_);
+            }
+
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+        private:
+            std::string key_;
+            std::string old_;
+            bool hadOld_;
+        };
+
+    private:
+        using Entry = std::pair<std::string, std::string>;
+
+        struct Context
+        {
+            std::vector<Entry> entries_;
+            std::string rendered_;
+
+            Entry *find(const char *key)
+            {
+                for (auto &entry : entries_)
+                {
+                    if (entry.first == key)
+                        return &entry;
+                }
+                return nullptr;
+            }
+
+            // 仅在上下文变化时调用
+            void render()
+            {
+                fmt::memory_buffer buffer;
+                for (size_t i = 0; i < entries_.size(); ++i)
+                {
+                    if (i > 0)
+                        buffer.push_back(' ');
+                    Escape::logfmt(buffer, entries_[i].first.data(), entries_[i].first.size());
+                    buffer.push_back('=');
+                    Escape::logfmt(buffer, entries_[i].second.data(), entries_[i].second.size());
+                }
+                rendered_.assign(buffer.data(), buffer.size());
+            }
+        };
+
+        static Context &current()
+        {
+            thread_local Context ctx;
+            return ctx;
+        }
+    };
+};
@@ -2,6 +2,7 @@
 #include "level.hpp"
 #include "util.hpp"
 #include <thread>
+#include <cstring>
 /*
     日志消息类的设计
         1. 日志输出时间
@@ -10,10 +11,12 @@
         4. 线程ID
         5. 日志主体消息
         6. 日志器名称
+        7. 结构化字段
 */
 namespace zlog
 {
     using threadId = std::thread::id;
+    struct KvField;
     struct LogMessage
     {
         time_t curtime_;        // 日志输出时间
@@ -21,15 +24,21 @@ namespace zlog
         const char *file_;      // 源码文件名称与行号
         size_t line_;
         threadId tid_;        // 线程ID
+        const ThreadInfo *thread_; // 所属线程预渲染的ID与名称
         const char *payload_; // 日志主体消息
+        size_t payloadLen_;
         const char *loggerName_;  // 日志器名称
+        const KvField *fields_;   // 结构化字段--仅在本次日志调用内有效
+        size_t fieldCount_;
 
         LogMessage(LogLevel::value level,
                    const char *file, size_t line,
                    const char *payload, const char *loggerName)
             : curtime_(Date::getCurrentTime()), level_(level),
               file_(file), line_(line), tid_(std::this_thread::get_id()),
-              payload_(payload), loggerName_(loggerName)
+              thread_(&ThreadInfo::current()),
+              payload_(payload), payloadLen_(strlen(payload)), loggerName_(loggerName),
+              fields_(nullptr), fieldCount_(0)
         {
         }
     };
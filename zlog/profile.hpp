@@ -0,0 +1,275 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fmt/format.h>
+
+/*
+    调用点流量分析(编译时定义ZLOG_PROFILE_CALLSITES开启)
+        1. 以ZLOG_*宏传入的(__FILE__, __LINE__)为键，在固定大小的开放寻址表中为每个调用点维护计数
+        2. 查找与计数均为无锁原子操作；表满后的调用点计入溢出项
+        3. 统计调用次数、写出的记录数、字节数以及格式化耗时，可在运行时或退出时输出排序后的前N项
+    未定义该宏时日志器中的埋点展开为空操作，没有额外开销
+*/
+namespace zlog
+{
+    enum class ProfileOrder
+    {
+        BYTES,   // 按写出字节数
+        CALLS,   // 按调用次数
+        RECORDS, // 按写出记录数
+        TIME,    // 按格式化总耗时
+    };
+
+    struct CallSiteReport
+    {
+        std::string file_;
+        size_t line_ = 0;
+        uint64_t calls_ = 0;
+        uint64_t records_ = 0;
+        uint64_t bytes_ = 0;
+        uint64_t formatNs_ = 0;
+    };
+
+    class CallSiteProfiler
+    {
+    public:
+        static constexpr size_t SLOTS = 4096; // 2的幂
+
+        static CallSiteProfiler &instance()
+        {
+            static CallSiteProfiler profiler;
+            return profiler;
+        }
+
+        // 一次日志调用(含被等级过滤的调用)，开始计时
+        void called(const char *file, size_t line)
+        {
+            Current &cur = current();
+            cur.site_ = find(file, line);
+            cur.begin_ = std::chrono::steady_clock::now();
+            cur.site_->calls_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // 记录格式化完成；emitted为假表示记录被保留在回溯环中，尚未写出
+        void formatted(const char *file, size_t line, size_t bytes, bool emitted)
+        {
+            Current &cur = current();
+            Slot *site = cur.site_;
+            // 格式化参数时嵌套写日志会覆盖当前调用点，此时重新查找且不计耗时
+            bool timed = site != nullptr && site->file_ == file && site->line_ == line;
+            if (!timed)
+                site = find(file, line);
+            if (timed)
+            {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - cur.begin_).count();
+                site->formatNs_.fetch_add(static_cast<uint64_t>(ns), std::memory_order_relaxed);
+            }
+            cur.site_ = nullptr;
+            if (emitted)
+            {
+                site->records_.fetch_add(1, std::memory_order_relaxed);
+                site->bytes_.fetch_add(bytes, std::memory_order_relaxed);
+            }
+        }
+
+        // 汇总所有调用点并按order降序排列，topN为0时返回全部
+        std::vector<CallSiteReport> top(size_t topN, ProfileOrder order = ProfileOrder::BYTES)
+        {
+            std::vector<CallSiteReport> sites;
+            for (size_t i = 0; i <= SLOTS; ++i)
+            {
+                Slot &slot = slots_[i];
+                if (slot.state_.load(std::memory_order_acquire) != READY || slot.calls_.load(std::memory_order_relaxed) == 0)
+                    continue;
+                CallSiteReport site;
+                site.file_ = slot.file_;
+                site.line_ = slot.line_;
+                site.calls_ = slot.calls_.load(std::memory_order_relaxed);
+                site.records_ = slot.records_.load(std::memory_order_relaxed);
+                site.bytes_ = slot.bytes_.load(std::memory_order_relaxed);
+                site.formatNs_ = slot.formatNs_.load(std::memory_order_relaxed);
+                // 不同编译单元中的同一文件名可能位于不同地址，按内容合并
+                auto same = std::find_if(sites.begin(), sites.end(), [&site](const CallSiteReport &other)
+                                         { return other.line_ == site.line_ && other.file_ == site.file_; });
+                if (same == sites.end())
+                {
+                    sites.push_back(site);
+                    continue;
+                }
+                same->calls_ += site.calls_;
+                same->records_ += site.records_;
+                same->bytes_ += site.bytes_;
+                same->formatNs_ += site.formatNs_;
+            }
+            std::sort(sites.begin(), sites.end(), [order](const CallSiteReport &a, const CallSiteReport &b)
+                      { return key(a, order) > key(b, order); });
+            if (topN != 0 && sites.size() > topN)
+                sites.resize(topN);
+            return sites;
+        }
+
+        // 文本报表
+        std::string report(size_t topN = 20, ProfileOrder order = ProfileOrder::BYTES)
+        {
+            std::vector<CallSiteReport> sites = top(topN, order);
+            fmt::memory_buffer out;
+            auto it = std::back_inserter(out);
+            fmt::format_to(it, "{:>12} {:>12} {:>14} {:>14} {:>10}  {}\n", "calls", "records", "bytes", "format_ns", "avg_ns", "site");
+            for (auto &site : sites)
+            {
+                uint64_t avg = site.calls_ == 0 ? 0 : site.formatNs_ / site.calls_;
+                fmt::format_to(it, "{:>12} {:>12} {:>14} {:>14} {:>10}  {}:{}\n", site.calls_, site.records_, site.bytes_,
+                               site.formatNs_, avg, site.file_, site.line_);
+            }
+            return std::string(out.data(), out.size());
+        }
+
+        // 进程正常退出时将报表写入path，path为空时写入标准错误
+        void reportAtExit(size_t topN = 20, ProfileOrder order = ProfileOrder::BYTES, const std::string &path = "")
+        {
+            exitTopN_ = topN;
+            exitOrder_ = order;
+            exitPath_ = path;
+            static std::once_flag once;
+            std::call_once(once, []()
+                           { std::atexit(&CallSiteProfiler::exitReport); });
+        }
+
+        // 清空计数，调用点本身保留
+        void reset()
+        {
+            for (auto &slot : slots_)
+            {
+                slot.calls_.store(0, std::memory_order_relaxed);
+                slot.records_.store(0, std::memory_order_relaxed);
+                slot.bytes_.store(0, std::memory_order_relaxed);
+                slot.formatNs_.store(0, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        enum : int
+        {
+            EMPTY = 0,
+            CLAIMING,
+            READY,
+        };
+
+        // 以填充对齐到缓存行，不同调用点的计数互不干扰
+        struct Slot
+        {
+            std::atomic<int> state_;
+            const char *file_;
+            size_t line_;
+            std::atomic<uint64_t> calls_;
+            std::atomic<uint64_t> records_;
+            std::atomic<uint64_t> bytes_;
+            std::atomic<uint64_t> formatNs_;
+            char pad_[64 - 7 * sizeof(uint64_t)];
+        };
+
+        struct Current
+        {
+            Slot *site_ = nullptr;
+            std::chrono::steady_clock::time_point begin_;
+        };
+
+        CallSiteProfiler()
+            : exitTopN_(20), exitOrder_(ProfileOrder::BYTES)
+        {
+            for (auto &slot : slots_)
+            {
+                slot.state_.store(EMPTY, std::memory_order_relaxed);
+                slot.file_ = nullptr;
+                slot.line_ = 0;
+            }
+            slots_[SLOTS].file_ = "<overflow>";
+            slots_[SLOTS].state_.store(READY, std::memory_order_relaxed);
+            reset();
+        }
+
+        static Current &current()
+        {
+            thread_local Current cur;
+            return cur;
+        }
+
+        static uint64_t key(const CallSiteReport &site, ProfileOrder order)
+        {
+            switch (order)
+            {
+            case ProfileOrder::CALLS:
+                return site.calls_;
+            case ProfileOrder::RECORDS:
+                return site.records_;
+            case ProfileOrder::TIME:
+                return site.formatNs_;
+            case ProfileOrder::BYTES:
+            default:
+                return site.bytes_;
+            }
+        }
+
+        static void exitReport()
+        {
+            CallSiteProfiler &profiler = instance();
+            std::string text = profiler.report(profiler.exitTopN_, profiler.exitOrder_);
+            FILE *fp = profiler.exitPath_.empty() ? stderr : fopen(profiler.exitPath_.c_str(), "w");
+            if (fp == nullptr)
+                return;
+            fwrite(text.data(), 1, text.size(), fp);
+            if (fp != stderr)
+                fclose(fp);
+        }
+
+        // 线性探测；__FILE__为字面量，按地址比较即可
+        Slot *find(const char *file, size_t line)
+        {
+            uint64_t h = (reinterpret_cast<uintptr_t>(file) ^ (static_cast<uint64_t>(line) << 32)) * 0x9E3779B97F4A7C15ULL;
+            size_t index = static_cast<size_t>(h >> 52) & (SLOTS - 1);
+            for (size_t probe = 0; probe < SLOTS; ++probe, index = (index + 1) & (SLOTS - 1))
+            {
+                Slot &slot = slots_[index];
+                int state = slot.state_.load(std::memory_order_acquire);
+                if (state == EMPTY)
+                {
+                    if (slot.state_.compare_exchange_strong(state, CLAIMING, std::memory_order_acq_rel))
+                    {
+                        slot.file_ = file;
+                        slot.line_ = line;
+                        slot.state_.store(READY, std::memory_order_release);
+                        return &slot;
+                    }
+                }
+                // 其他线程正在写入键，等待其完成
+                while (state == CLAIMING)
+                    state = slot.state_.load(std::memory_order_acquire);
+                if (slot.file_ == file && slot.line_ == line)
+                    return &slot;
+            }
+            return &slots_[SLOTS];
+        }
+
+    private:
+        Slot slots_[SLOTS + 1]; // 最后一项为溢出项
+        size_t exitTopN_;
+        ProfileOrder exitOrder_;
+        std::string exitPath_;
+    };
+};
+
+#ifdef ZLOG_PROFILE_CALLSITES
+#define ZLOG_PROFILE_CALL(file, line) zlog::CallSiteProfiler::instance().called(file, line)
+#define ZLOG_PROFILE_FORMATTED(file, line, bytes, emitted) zlog::CallSiteProfiler::instance().formatted(file, line, bytes, emitted)
+#else
+#define ZLOG_PROFILE_CALL(file, line) ((void)0)
+#define ZLOG_PROFILE_FORMATTED(file, line, bytes, emitted) ((void)0)
+#endif
@@ -0,0 +1,268 @@
+#pragma once
+#include "logger.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include <unordered_map>
+
+/*
+    运行时统计的汇总与导出
+        1. stats()汇总所有已注册日志器的快照，不阻塞写日志的线程
+        2. toPrometheus()将快照编码为Prometheus文本格式
+        3. StatsReporter按固定间隔将统计写入指定日志器，或原子替换一个文本文件(供node_exporter文本收集器读取)
+*/
+namespace zlog
+{
+    inline StatsSnapshot stats()
+    {
+        StatsSnapshot snap;
+        snap.time_ = std::chrono::system_clock::now();
+        for (auto &logger : LoggerManager::getInstance().loggers())
+            snap.loggers_.push_back(logger->snapshot());
+        return snap;
+    }
+
+    namespace detail
+    {
+        // 标签值转义：反斜杠、双引号与换行
+        inline std::string promLabel(const std::string &value)
+        {
+            std::string out;
+            out.reserve(value.size());
+            for (char c : value)
+            {
+                if (c == '\\' || c == '"')
+                {
+                    out.push_back('\\');
+                    out.push_back(c);
+                }
+                else if (c == '\n')
+                    out += "\\n";
+                else
+                    out.push_back(c);
+            }
+            return out;
+        }
+
+        inline void promHeader(fmt::memory_buffer &out, const char *name, const char *type, const char *help)
+        {
+            fmt::format_to(std::back_inserter(out), "# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+        }
+
+        inline void promSummary(fmt::memory_buffer &out, const char *name, const std::string &labels, const HistogramSnapshot &hist)
+        {
+            static const double QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+            for (double q : QUANTILES)
+                fmt::format_to(std::back_inserter(out), "{}{{{},quantile=\"{}\"}} {}\n", name, labels, q, hist.percentile(q));
+            fmt::format_to(std::back_inserter(out), "{}_sum{{{}}} {}\n{}_count{{{}}} {}\n", name, labels, hist.sum_, name, labels, hist.count_);
+        }
+    }
+
+    // 编码为Prometheus文本格式
+    inline std::string toPrometheus(const StatsSnapshot &snap)
+    {
+        fmt::memory_buffer out;
+        auto it = std::back_inserter(out);
+
+        detail::promHeader(out, "zlog_records_total", "counter", "Records written by level");
+        for (auto &logger : snap.loggers_)
+            for (size_t i = 0; i < LoggerSnapshot::LEVELS; ++i)
+                if (logger.records_[i] > 0)
+                    fmt::format_to(it, "zlog_records_total{{logger=\"{}\",level=\"{}\"}} {}\n", detail::promLabel(logger.name_),
+                                   LogLevel::toString(static_cast<LogLevel::value>(i)), logger.records_[i]);
+        detail::promHeader(out, "zlog_bytes_total", "counter", "Formatted bytes by level");
+        for (auto &logger : snap.loggers_)
+            for (size_t i = 0; i < LoggerSnapshot::LEVELS; ++i)
+                if (logger.bytes_[i] > 0)
+                    fmt::format_to(it, "zlog_bytes_total{{logger=\"{}\",level=\"{}\"}} {}\n", detail::promLabel(logger.name_),
+                                   LogLevel::toString(static_cast<LogLevel::value>(i)), logger.bytes_[i]);
+
+        // 异步工作器，分片时以shard区分
+        detail::promHeader(out, "zlog_queue_pending_bytes", "gauge", "Bytes waiting in the producer buffer");
+        for (auto &logger : snap.loggers_)
+            for (size_t i = 0; i < logger.loopers_.size(); ++i)
+                fmt::format_to(it, "zlog_queue_pending_bytes{{logger=\"{}\",shard=\"{}\"}} {}\n", detail::promLabel(logger.name_), i, logger.loopers_[i].pendingBytes_);
+        detail::promHeader(out, "zlog_buffer_capacity_bytes", "gauge", "Producer buffer capacity");
+        for (auto &logger : snap.loggers_)
+            for (size_t i = 0; i < logger.loopers_.size(); ++i)
+                fmt::format_to(it, "zlog_buffer_capacity_bytes{{logger=\"{}\",shard=\"{}\"}} {}\n", detail::promLabel(logger.name_), i, logger.loopers_[i].bufferCapacity_);
+        detail::promHeader(out, "zlog_producer_blocked_total", "counter", "Times a producer waited for buffer space");
+        for (auto &logger : snap.loggers_)
+            for (size_t i = 0; i < logger.loopers_.size(); ++i)
+                fmt::format_to(it, "zlog_producer_blocked_total{{logger=\"{}\",shard=\"{}\"}} {}\n", detail::promLabel(logger.name_), i, logger.loopers_[i].blocked_);
+        detail::promHeader(out, "zlog_buffer_growths_total", "counter", "Producer buffer reallocations");
+        for (auto &logger : snap.loggers_)
+            for (size_t i = 0; i < logger.loopers_.size(); ++i)
+                fmt::format_to(it, "zlog_buffer_growths_total{{logger=\"{}\",shard=\"{}\"}} {}\n", detail::promLabel(logger.name_), i, logger.loopers_[i].growths_);
+        detail::promHeader(out, "zlog_large_records_total", "counter", "Records stored outside the async buffer");
+        for (auto &logger : snap.loggers_)
+            for (size_t i = 0; i < logger.loopers_.size(); ++i)
+                fmt::format_to(it, "zlog_large_records_total{{logger=\"{}\",shard=\"{}\"}} {}\n", detail::promLabel(logger.name_), i, logger.loopers_[i].largeRecords_);
+        detail::promHeader(out, "zlog_producer_block_ns", "summary", "Time a producer spent waiting for buffer space");
+        for (auto &logger : snap.loggers_)
+            for (size_t i = 0; i < logger.loopers_.size(); ++i)
+                detail::promSummary(out, "zlog_producer_block_ns", fmt::format("logger=\"{}\",shard=\"{}\"", detail::promLabel(logger.name_), i), logger.loopers_[i].blockNs_);
+        detail::promHeader(out, "zlog_batch_bytes", "summary", "Bytes written per consumer batch");
+        for (auto &logger : snap.loggers_)
+            for (size_t i = 0; i < logger.loopers_.size(); ++i)
+                detail::promSummary(out, "zlog_batch_bytes", fmt::format("logger=\"{}\",shard=\"{}\"", detail::promLabel(logger.name_), i), logger.loopers_[i].batchBytes_);
+
+        // 落地方向
+        struct SinkCounter
+        {
+            const char *name_;
+            const char *help_;
+            uint64_t SinkSnapshot::*field_;
+        };
+        static const SinkCounter SINK_COUNTERS[] = {
+            {"zlog_sink_writes_total", "Sink write calls", &SinkSnapshot::writes_},
+            {"zlog_sink_bytes_total", "Bytes handed to the sink", &SinkSnapshot::bytes_},
+            {"zlog_sink_errors_total", "Failed sink writes", &SinkSnapshot::errors_},
+            {"zlog_sink_drops_total", "Records dropped by the sink", &SinkSnapshot::drops_},
+        };
+        for (auto &counter : SINK_COUNTERS)
+        {
+            detail::promHeader(out, counter.name_, "counter", counter.help_);
+            for (auto &logger : snap.loggers_)
+                for (auto &sink : logger.sinks_)
+                    fmt::format_to(it, "{}{{logger=\"{}\",sink=\"{}\"}} {}\n", counter.name_, detail::promLabel(logger.name_),
+                                   detail::promLabel(sink.name_), sink.*counter.field_);
+        }
+        detail::promHeader(out, "zlog_sink_write_ns", "summary", "Sink write latency");
+        for (auto &logger : snap.loggers_)
+            for (auto &sink : logger.sinks_)
+                detail::promSummary(out, "zlog_sink_write_ns", fmt::format("logger=\"{}\",sink=\"{}\"", detail::promLabel(logger.name_), detail::promLabel(sink.name_)), sink.latency_);
+        return std::string(out.data(), out.size());
+    }
+
+    /*定期输出统计*/
+    class StatsReporter
+    {
+    public:
+        // 每个间隔向logger写一行INFO，每个日志器一行，计数为区间增量
+        StatsReporter(std::chrono::milliseconds interval, const Logger::ptr &logger)
+            : interval_(interval), logger_(logger), stop_(false)
+        {
+            thread_ = std::thread(&StatsReporter::run, this);
+        }
+
+        // 每个间隔将Prometheus文本写入临时文件后改名替换path
+        StatsReporter(std::chrono::milliseconds interval, const std::string &path)
+            : interval_(interval), path_(path), stop_(false)
+        {
+            File::createDirectory(File::path(path_));
+            thread_ = std::thread(&StatsReporter::run, this);
+        }
+
+        ~StatsReporter()
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            cond_.notify_all();
+            thread_.join();
+        }
+
+        StatsReporter(const StatsReporter &) = delete;
+        StatsReporter &operator=(const StatsReporter &) = delete;
+
+    private:
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!cond_.wait_for(lock, interval_, [this]()
+                                   { return stop_; }))
+            {
+                lock.unlock();
+                report();
+                lock.lock();
+            }
+        }
+
+        void report()
+        {
+            StatsSnapshot snap = stats();
+            if (logger_)
+                reportToLogger(snap);
+            else
+                reportToFile(snap);
+        }
+
+        void reportToLogger(const StatsSnapshot &snap)
+        {
+            for (auto &logger : snap.loggers_)
+            {
+                uint64_t records = 0, bytes = 0;
+                for (size_t i = 0; i < LoggerSnapshot::LEVELS; ++i)
+                {
+                    records += logger.records_[i];
+                    bytes += logger.bytes_[i];
+                }
+                uint64_t pending = 0, blocked = 0, growths = 0;
+                for (auto &looper : logger.loopers_)
+                {
+                    pending += looper.pendingBytes_;
+                    blocked += looper.blocked_;
+                    growths += looper.growths_;
+                }
+                uint64_t errors = 0, drops = 0, writeP99 = 0;
+                for (auto &sink : logger.sinks_)
+                {
+                    errors += sink.errors_;
+                    drops += sink.drops_;
+                    writeP99 = std::max(writeP99, sink.latency_.percentile(0.99));
+                }
+
+                // 计数换算为区间增量
+                Previous &prev = previous_[logger.name_];
+                logger_->logImpl(LogLevel::value::INFO, __FILE__, __LINE__, "zlog stats logger={} records={} bytes={} pending={} blocked={} growths={} errors={} drops={} write_p99_ns={}",
+                                  logger.name_, records - prev.records_, bytes - prev.bytes_, pending, blocked - prev.blocked_,
+                                  growths - prev.growths_, errors - prev.errors_, drops - prev.drops_, writeP99);
+                prev.records_ = records;
+                prev.bytes_ = bytes;
+                prev.blocked_ = blocked;
+                prev.growths_ = growths;
+                prev.errors_ = errors;
+                prev.drops_ = drops;
+            }
+        }
+
+        void reportToFile(const StatsSnapshot &snap)
+        {
+            std::string text = toPrometheus(snap);
+            std::string tmp = path_ + ".tmp";
+            FILE *fp = fopen(tmp.c_str(), "w");
+            if (fp == nullptr)
+            {
+                std::cerr << "写入统计文件失败: " << tmp << std::endl;
+                return;
+            }
+            bool ok = fwrite(text.data(), 1, text.size(), fp) == text.size();
+            ok = fclose(fp) == 0 && ok;
+            if (!ok || rename(tmp.c_str(), path_.c_str()) != 0)
+                std::cerr << "写入统计文件失败: " << path_ << std::endl;
+        }
+
+    private:
+        struct Previous
+        {
+            uint64_t records_ = 0;
+            uint64_t bytes_ = 0;
+            uint64_t blocked_ = 0;
+            uint64_t growths_ = 0;
+            uint64_t errors_ = 0;
+            uint64_t drops_ = 0;
+        };
+
+        std::chrono::milliseconds interval_;
+        Logger::ptr logger_;
+        std::string path_;
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        bool stop_;
+        std::unordered_map<std::string, Previous> previous_;
+        std::thread thread_;
+    };
+};
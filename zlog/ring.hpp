@@ -0,0 +1,253 @@
+#pragma once
+#include "util.hpp"
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <ctime>
+#include <new>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/*
+    崩溃保留的飞行记录环
+        1. 文件映射(/dev/shm或磁盘)的环形字节流，写入后立即位于内核页缓存中，进程崩溃不会丢失
+        2. 头部记录已提交位置committed_与已落地位置read_，二者均单调递增，取模得到环内偏移
+        3. [read_, committed_) 为尚未确认写入落地方向的数据，zlog-recover从中恢复
+        4. 正常关闭且数据全部落地时删除文件；打开时发现未恢复的数据则改名为<path>.crashed-<时间>-<进程号>保留，
+           多次崩溃的数据互不覆盖
+    进程无需fsync或处理信号；机器掉电时仍可能丢失尚未回写的页
+*/
+namespace zlog
+{
+    struct RingHeader
+    {
+        char magic_[8];                   // "ZLOGRING"
+        uint32_t version_;
+        uint32_t headerSize_;             // 数据区起始偏移
+        uint64_t capacity_;               // 数据区大小
+        std::atomic<uint64_t> committed_; // 已提交的字节位置
+        std::atomic<uint64_t> read_;      // 已落地的字节位置
+        int64_t pid_;                     // 写入进程
+        int64_t created_;                 // 创建时间(秒)
+    };
+
+    class MmapRing
+    {
+    public:
+        static constexpr uint32_t RING_VERSION = 1;
+        static constexpr size_t RING_HEADER_SIZE = 4096;
+
+        MmapRing(const std::string &path, size_t capacity)
+            : path_(path), fd_(-1), base_(nullptr), header_(nullptr), data_(nullptr), capacity_(capacity)
+        {
+#ifndef _WIN32
+            File::createDirectory(File::path(path_));
+            if (!preserve())
+                return; // 不覆盖无法保留的数据，飞行记录不开启
+            fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd_ < 0 || ftruncate(fd_, static_cast<off_t>(RING_HEADER_SIZE + capacity_)) != 0)
+            {
+                std::cerr << "创建飞行记录文件失败: " << path_ << " " << strerror(errno) << std::endl;
+                return;
+            }
+            void *base = mmap(nullptr, RING_HEADER_SIZE + capacity_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            if (base == MAP_FAILED)
+            {
+                std::cerr << "映射飞行记录文件失败: " << path_ << " " << strerror(errno) << std::endl;
+                return;
+            }
+            base_ = static_cast<char *>(base);
+            header_ = new (base_) RingHeader();
+            data_ = base_ + RING_HEADER_SIZE;
+            header_->version_ = RING_VERSION;
+            header_->headerSize_ = RING_HEADER_SIZE;
+            header_->capacity_ = capacity_;
+            header_->committed_.store(0, std::memory_order_relaxed);
+            header_->read_.store(0, std::memory_order_relaxed);
+            header_->pid_ = static_cast<int64_t>(getpid());
+            header_->created_ = static_cast<int64_t>(time(nullptr));
+            // 魔数最后写入，恢复工具据此判断头部完整
+            std::atomic_thread_fence(std::memory_order_release);
+            memcpy(header_->magic_, "ZLOGRING", 8);
+#else
+            std::cerr << "当前平台不支持飞行记录" << std::endl;
+#endif
+        }
+
+        ~MmapRing()
+        {
+            close();
+        }
+
+        MmapRing(const MmapRing &) = delete;
+        MmapRing &operator=(const MmapRing &) = delete;
+
+        bool valid() const
+        {
+            return header_ != nullptr;
+        }
+
+        size_t capacity() const
+        {
+            return capacity_;
+        }
+
+        // 剩余空间
+        size_t writable() const
+        {
+            return capacity_ - static_cast<size_t>(header_->committed_.load(std::memory_order_relaxed) -
+                                                   header_->read_.load(std::memory_order_relaxed));
+        }
+
+        uint64_t committed() const
+        {
+            return header_->committed_.load(std::memory_order_relaxed);
+        }
+
+        // 追加数据并提交，调用者保证串行且空间足够
+        void append(const char *data, size_t len)
+        {
+            uint64_t pos = header_->committed_.load(std::memory_order_relaxed);
+            size_t offset = static_cast<size_t>(pos % capacity_);
+            size_t first = std::min(len, capacity_ - offset);
+            memcpy(data_ + offset, data, first);
+            memcpy(data_, data + first, len - first);
+            header_->committed_.store(pos + len, std::memory_order_release);
+        }
+
+        // pos之前的数据均已落地
+        void release(uint64_t pos)
+        {
+            header_->read_.store(pos, std::memory_order_release);
+        }
+
+        // 解除映射；数据已全部落地时删除文件
+        void close()
+        {
+#ifndef _WIN32
+            if (header_ != nullptr)
+            {
+                bool clean = header_->read_.load() == header_->committed_.load();
+                munmap(base_, RING_HEADER_SIZE + capacity_);
+                header_ = nullptr;
+                if (clean)
+                    unlink(path_.c_str());
+            }
+            if (fd_ >= 0)
+            {
+                ::close(fd_);
+                fd_ = -1;
+            }
+#endif
+        }
+
+        /*
+            从飞行记录文件中恢复尚未落地的数据并写入out
+                返回恢复的字节数，文件无效时返回-1并设置err
+                高优先级通道的记录可能先于普通记录落地，恢复结果中可能包含已经落地的高优先级记录
+        */
+        static long long recover(const std::string &path, FILE *out, std::string &err)
+        {
+#ifndef _WIN32
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                err = strerror(errno);
+                return -1;
+            }
+            struct stat st;
+            if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < RING_HEADER_SIZE)
+            {
+                ::close(fd);
+                err = "文件过小";
+                return -1;
+            }
+            size_t size = static_cast<size_t>(st.st_size);
+            void *base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (base == MAP_FAILED)
+            {
+                err = strerror(errno);
+                return -1;
+            }
+            const char *bytes = static_cast<const char *>(base);
+            const RingHeader *header = reinterpret_cast<const RingHeader *>(bytes);
+            long long result = -1;
+            uint64_t committed = header->committed_.load(std::memory_order_acquire);
+            uint64_t read = header->read_.load(std::memory_order_acquire);
+            if (memcmp(header->magic_, "ZLOGRING", 8) != 0 || header->version_ != RING_VERSION)
+                err = "不是飞行记录文件";
+            else if (header->headerSize_ + header->capacity_ > size || header->capacity_ == 0)
+                err = "头部与文件大小不符";
+            else if (committed < read || committed - read > header->capacity_)
+                err = "提交位置损坏";
+            else
+            {
+                const char *data = bytes + header->headerSize_;
+                size_t capacity = static_cast<size_t>(header->capacity_);
+                size_t len = static_cast<size_t>(committed - read);
+                size_t offset = static_cast<size_t>(read % capacity);
+                size_t first = std::min(len, capacity - offset);
+                fwrite(data + offset, 1, first, out);
+                fwrite(data, 1, len - first, out);
+                result = static_cast<long long>(len);
+            }
+            munmap(base, size);
+            return result;
+#else
+            err = "当前平台不支持飞行记录";
+            return -1;
+#endif
+        }
+
+    private:
+        // 上次运行留下未恢复的数据时改名保留，避免被新的记录覆盖；无法保留时返回false
+        bool preserve()
+        {
+            std::string err;
+            FILE *null = fopen("/dev/null", "w");
+            long long left = null == nullptr ? -1 : recover(path_, null, err);
+            if (null != nullptr)
+                fclose(null);
+            if (left <= 0)
+                return true;
+            // link在目标已存在时失败，不会覆盖此前保留的文件
+            char stamp[32];
+            time_t now = time(nullptr);
+            struct tm tm;
+            localtime_r(&now, &tm);
+            strftime(stamp, sizeof(stamp), "%Y%m%d%H%M%S", &tm);
+            std::string base = path_ + ".crashed-" + stamp + "-" + std::to_string(getpid());
+            for (int seq = 0; seq < 100; ++seq)
+            {
+                std::string crashed = seq == 0 ? base : base + "." + std::to_string(seq);
+                if (link(path_.c_str(), crashed.c_str()) == 0)
+                {
+                    unlink(path_.c_str());
+                    std::cerr << "飞行记录中有" << left << "字节未落地的数据，已保存到" << crashed
+                              << "，可使用zlog-recover恢复" << std::endl;
+                    return true;
+                }
+                if (errno != EEXIST)
+                    break;
+            }
+            std::cerr << "无法保留飞行记录中未落地的数据: " << path_ << " " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        std::string path_;
+        int fd_;
+        char *base_;
+        RingHeader *header_;
+        char *data_;
+        size_t capacity_;
+    };
+};
@@ -1,5 +1,8 @@
 #pragma once
 #include "util.hpp"
+#include "level.hpp"
+#include "stats.hpp"
+#include "index.hpp"
 #include <fmt/core.h>
 #include <fmt/ostream.h>
 #include <fmt/format.h>
@@ -7,10 +10,23 @@
 #include <string>
 #include <chrono>
 #include <fstream>
+#include <mutex>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <condition_variable>
 
 // 平台相关
 #ifdef _WIN32
 #include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <climits>
+#include <sys/uio.h>
+#include <sys/stat.h>
 #endif
 
 /*
@@ -28,6 +44,61 @@ namespace zlog
         LogSink() {}
         virtual ~LogSink() {}
         virtual void log(const char *data, size_t len) = 0;
+
+        // 单条记录落地(同步日志器)，可按等级区分输出；默认忽略等级
+        virtual void log(LogLevel::value, const char *data, size_t len)
+        {
+            log(data, len);
+        }
+
+        // 是否允许多个线程同时调用log，为真时同步日志器不再加锁
+        virtual bool threadSafe() const
+        {
+            return false;
+        }
+
+        // 将用户态缓冲的数据写出到内核
+        virtual void flush() {}
+
+        // 将已写出的数据同步到存储设备
+        virtual void sync() {}
+
+        // 统计中使用的名称
+        virtual std::string name() const
+        {
+            return "sink";
+        }
+
+        // 写出并记录次数、字节数与耗时，由日志器调用
+        void emit(const char *data, size_t len)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            log(data, len);
+            record(begin, len);
+        }
+
+        void emit(LogLevel::value level, const char *data, size_t len)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            log(level, data, len);
+            record(begin, len);
+        }
+
+        SinkStats &stats()
+        {
+            return stats_;
+        }
+
+    protected:
+        void record(std::chrono::steady_clock::time_point begin, size_t len)
+        {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+            stats_.writes_.add();
+            stats_.bytes_.add(len);
+            stats_.latency_.record(static_cast<uint64_t>(ns));
+        }
+
+        SinkStats stats_;
     };
 
     // 标准输出
@@ -36,39 +107,576 @@ namespace zlog
     public:
         void log(const char *data, size_t len) override
         {
-            fmt::print(stdout, "{:.{}}", data, len);
+            // 直接写出，避免fmt为整批数据构造临时缓冲区
+            fwrite(data, 1, len, stdout);
+        }
+
+        void flush() override
+        {
+            fflush(stdout);
+        }
+
+        std::string name() const override
+        {
+            return "stdout";
         }
     };
 
     class FileSink : public LogSink
     {
     public:
-        FileSink(const std::string &pathname)
-            : pathname_(pathname)
+        // indexInterval大于0时按该间隔写时间索引<pathname>.idx
+        FileSink(const std::string &pathname, std::chrono::milliseconds indexInterval = std::chrono::milliseconds(0))
+            : pathname_(pathname), offset_(0)
         {
             File::createDirectory(File::path(pathname_));
             ofs_.open(pathname_, std::ios::binary | std::ios::app);
+            if (indexInterval.count() > 0)
+            {
+                std::ifstream ifs(pathname_, std::ios::binary | std::ios::ate);
+                offset_ = static_cast<uint64_t>(ifs.tellg());
+                index_.reset(new TimeIndex(pathname_, indexInterval));
+            }
         }
 
         void log(const char *data, size_t len) override
         {
-            fmt::print(ofs_, "{:.{}}", data, len);
-            ofs_.flush(); // 确保日志及时写入磁盘
+            write(data, len, TimeIndex::ALL_LEVELS);
+        }
+
+        void log(LogLevel::value level, const char *data, size_t len) override
+        {
+            write(data, len, TimeIndex::levelBit(level));
+        }
+
+        void flush() override
+        {
+            ofs_.flush();
+        }
+
+        std::string name() const override
+        {
+            return pathname_;
+        }
+
+        void sync() override
+        {
+            ofs_.flush();
+            if (!File::sync(pathname_))
+                std::cerr << "同步日志文件失败: " << pathname_ << std::endl;
         }
 
     protected:
+        void write(const char *data, size_t len, uint32_t levels)
+        {
+            ofs_.write(data, len);
+            ofs_.flush(); // 确保日志及时写入磁盘
+            if (!ofs_.good())
+                stats_.errors_.add();
+            if (index_)
+            {
+                index_->note(offset_, len, levels);
+                offset_ += len;
+            }
+        }
+
         std::string pathname_;
         std::ofstream ofs_;
+        std::unique_ptr<TimeIndex> index_; // 未开启索引时为空
+        uint64_t offset_;                  // 下一次写入在文件中的偏移，仅在开启索引时维护
+    };
+
+#ifndef _WIN32
+    /*
+        以O_APPEND打开的文件，调用线程直接write(2)，不经过用户态锁
+            1. 每条记录一次write，由内核保证整条记录追加到文件末尾，多线程写入互不交错
+            2. 超过atomicLimit的记录或出现部分写入时，独占文件完成剩余写入：
+               先阻止新的无锁写入，等待进行中的写入结束，再分多次写出
+    */
+    class AppendFileSink : public LogSink
+    {
+    public:
+        static constexpr size_t DEFAULT_ATOMIC_LIMIT = 1024 * 64;
+
+        AppendFileSink(const std::string &pathname, size_t atomicLimit = DEFAULT_ATOMIC_LIMIT)
+            : pathname_(pathname), atomicLimit_(atomicLimit), active_(0), exclusive_(false)
+        {
+            File::createDirectory(File::path(pathname_));
+            fd_ = ::open(pathname_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if (fd_ < 0)
+                std::cerr << "打开日志文件失败: " << pathname_ << " " << strerror(errno) << std::endl;
+        }
+
+        ~AppendFileSink()
+        {
+            if (fd_ >= 0)
+                ::close(fd_);
+        }
+
+        void log(const char *data, size_t len) override
+        {
+            if (fd_ < 0 || len == 0)
+                return;
+            if (len <= atomicLimit_)
+            {
+                // 无锁路径：登记进行中的写入后确认没有独占写入
+                active_.fetch_add(1, std::memory_order_seq_cst);
+                if (!exclusive_.load(std::memory_order_seq_cst))
+                {
+                    ssize_t n = writeOnce(data, len);
+                    active_.fetch_sub(1, std::memory_order_seq_cst);
+                    if (n < 0 || static_cast<size_t>(n) == len)
+                        return;
+                    // 部分写入：剩余部分独占写出，尽量减少与其他记录交错
+                    data += n;
+                    len -= n;
+                }
+                else
+                {
+                    active_.fetch_sub(1, std::memory_order_seq_cst);
+                }
+            }
+            writeExclusive(data, len);
+        }
+
+        bool threadSafe() const override
+        {
+            return true;
+        }
+
+        std::string name() const override
+        {
+            return pathname_;
+        }
+
+        void sync() override
+        {
+            if (fd_ >= 0 && fdatasync(fd_) != 0)
+                std::cerr << "同步日志文件失败: " << pathname_ << " " << strerror(errno) << std::endl;
+        }
+
+    protected:
+        // 一次write，EINTR时重试；失败返回-1
+        ssize_t writeOnce(const char *data, size_t len)
+        {
+            ssize_t n;
+            do
+            {
+                n = ::write(fd_, data, len);
+            } while (n < 0 && errno == EINTR);
+            if (n < 0)
+            {
+                stats_.errors_.add();
+                std::cerr << "写入日志文件失败: " << pathname_ << " " << strerror(errno) << std::endl;
+            }
+            return n;
+        }
+
+        void writeExclusive(const char *data, size_t len)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            exclusive_.store(true, std::memory_order_seq_cst);
+            while (active_.load(std::memory_order_seq_cst) != 0)
+                std::this_thread::yield();
+            while (len > 0)
+            {
+                ssize_t n = writeOnce(data, len);
+                if (n <= 0)
+                    break;
+                data += n;
+                len -= n;
+            }
+            exclusive_.store(false, std::memory_order_seq_cst);
+        }
+
+        std::string pathname_;
+        int fd_;
+        size_t atomicLimit_;           // 不超过该长度的记录走无锁路径
+        std::atomic<size_t> active_;   // 进行中的无锁写入数
+        std::atomic<bool> exclusive_;  // 是否有独占写入
+        std::mutex mutex_;             // 独占写入之间互斥
+    };
+#endif
+
+#ifndef _WIN32
+    /*控制台写满时的处理方式*/
+    enum class ConsolePolicy
+    {
+        BLOCK, // 等待终端或管道读取方
+        DROP   // 不等待，缓冲区满时丢弃新记录并计数
     };
 
+    /*
+        批量写出的控制台落地
+            1. 记录先追加到内部缓冲区，由其中一个调用线程(写出者)以writev批量写出，
+               写出期间其他线程只追加数据，不等待终端；写出者每次调用最多取走一批新数据，
+               剩余数据由下一个调用线程或flush写出，持续写入时不会有线程一直无法返回
+            2. DROP策略使用非阻塞描述符，管道写满时保留未写完的批次，缓冲区满时丢弃新记录
+            3. 输出到终端时按等级着色，颜色为预先准备的字节串，与记录一起由writev写出；
+               异步日志器按批落地，不区分等级，不着色
+    */
+    class ConsoleSink : public LogSink
+    {
+    public:
+        static constexpr size_t DEFAULT_CONSOLE_BUFFER_SIZE = 1024 * 256;
+
+        // color: 1着色，0不着色，-1在终端上时着色
+        explicit ConsoleSink(ConsolePolicy policy = ConsolePolicy::BLOCK, int color = -1,
+                             int fd = STDOUT_FILENO, size_t bufferSize = DEFAULT_CONSOLE_BUFFER_SIZE)
+            : policy_(policy), fd_(fd), ownFd_(false), maxPending_(bufferSize),
+              pendingBytes_(0), writing_(false), dropped_(0), reported_(0)
+        {
+            color_ = color < 0 ? isatty(fd) == 1 : color == 1;
+            pending_.data_.reserve(maxPending_);
+            batch_.data_.reserve(maxPending_);
+            pending_.segs_.reserve(SEGMENT_RESERVE);
+            batch_.segs_.reserve(SEGMENT_RESERVE);
+            if (policy_ == ConsolePolicy::DROP)
+                openNonBlocking();
+        }
+
+        ~ConsoleSink()
+        {
+            // 尽量写出剩余数据，DROP策略最多等待一小段时间
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this]()
+                       { return !writing_; });
+            for (int retry = 0; retry < 100 && (!batchDone() || !pending_.segs_.empty()); ++retry)
+            {
+                writing_ = true;
+                combine(lock);
+                if (!batchDone())
+                {
+                    struct pollfd pfd = {fd_, POLLOUT, 0};
+                    poll(&pfd, 1, 10);
+                }
+            }
+            if (ownFd_)
+                ::close(fd_);
+        }
+
+        void log(const char *data, size_t len) override
+        {
+            append(nullptr, data, len);
+        }
+
+        void log(LogLevel::value level, const char *data, size_t len) override
+        {
+            append(color_ ? colorOf(level) : nullptr, data, len);
+        }
+
+        bool threadSafe() const override
+        {
+            return true;
+        }
+
+        std::string name() const override
+        {
+            return "console";
+        }
+
+        // 写出缓冲区中的全部数据；DROP策略下管道已满时不等待
+        void flush() override
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (true)
+            {
+                cond_.wait(lock, [this]()
+                           { return !writing_; });
+                writing_ = true;
+                if (!combine(lock) || pending_.segs_.empty())
+                    break;
+            }
+        }
+
+        // 丢弃的记录数：DROP策略下缓冲区已满，或写出失败时放弃的记录
+        uint64_t dropped()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            return dropped_;
+        }
+
+    private:
+        static constexpr size_t SEGMENT_RESERVE = 1024;
+
+        // 一段输出：静态字节串(颜色)或缓冲区中的一段
+        struct Segment
+        {
+            const char *static_; // 非空时为静态字节串
+            size_t offset_;
+            size_t len_;
+            size_t records_; // 在本段结束的记录数
+        };
+
+        struct Batch
+        {
+            std::vector<char> data_;
+            std::vector<Segment> segs_;
+            size_t seg_ = 0;    // 已写出的段数
+            size_t offset_ = 0; // 当前段已写出的字节数
+
+            void clear()
+            {
+                data_.clear();
+                segs_.clear();
+                seg_ = 0;
+                offset_ = 0;
+            }
+        };
+
+        static const char *colorOf(LogLevel::value level)
+        {
+            switch (level)
+            {
+            case LogLevel::value::DEBUG:
+                return "\033[36m";
+            case LogLevel::value::INFO:
+                return "\033[32m";
+            case LogLevel::value::WARNING:
+                return "\033[33m";
+            case LogLevel::value::ERROR:
+                return "\033[31m";
+            case LogLevel::value::FATAL:
+                return "\033[1;31m";
+            default:
+                return nullptr;
+            }
+        }
+
+        static const char *reset()
+        {
+            return "\033[0m";
+        }
+
+        // 重新打开同一终端或管道得到独立的文件描述，设置O_NONBLOCK不影响共享该描述的其他进程
+        void openNonBlocking()
+        {
+            struct stat st;
+            if (fstat(fd_, &st) == 0 && S_ISREG(st.st_mode))
+                return; // 普通文件不会写满
+            std::string path = "/proc/self/fd/" + std::to_string(fd_);
+            int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC | O_NONBLOCK);
+            if (fd < 0)
+            {
+                std::cerr << "控制台无法以非阻塞方式打开，写出前以poll检测: " << strerror(errno) << std::endl;
+                return;
+            }
+            fd_ = fd;
+            ownFd_ = true;
+        }
+
+        void append(const char *color, const char *data, size_t len)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (pendingBytes_ + len > maxPending_ && pendingBytes_ > 0)
+            {
+                if (policy_ == ConsolePolicy::DROP)
+                {
+                    dropped_++;
+                    stats_.drops_.add();
+                    if (!writing_)
+                    {
+                        writing_ = true;
+                        combine(lock);
+                    }
+                    return;
+                }
+                // 没有写出者时自己接手写出，否则等待写出者取走数据
+                while (pendingBytes_ + len > maxPending_ && pendingBytes_ > 0)
+                {
+                    if (!writing_)
+                    {
+                        writing_ = true;
+                        combine(lock);
+                        continue;
+                    }
+                    cond_.wait(lock);
+                }
+            }
+
+            if (color != nullptr)
+                pending_.segs_.push_back(Segment{color, 0, strlen(color), 0});
+            size_t offset = pending_.data_.size();
+            pending_.data_.insert(pending_.data_.end(), data, data + len);
+            pendingBytes_ += len;
+            // 与上一段相邻时合并，减少iovec数量
+            if (color == nullptr && !pending_.segs_.empty() && pending_.segs_.back().static_ == nullptr &&
+                pending_.segs_.back().offset_ + pending_.segs_.back().len_ == offset)
+            {
+                pending_.segs_.back().len_ += len;
+                pending_.segs_.back().records_++;
+            }
+            else
+                pending_.segs_.push_back(Segment{nullptr, offset, len, 1});
+            if (color != nullptr)
+                pending_.segs_.push_back(Segment{reset(), 0, strlen(reset()), 0});
+
+            // 已有写出者时由它顺带写出
+            if (writing_)
+                return;
+            writing_ = true;
+            combine(lock);
+        }
+
+        // 调用者持有锁且已设置writing_：写完已有批次，再反复取走写出期间新追加的数据，直到没有待写出数据；
+        //   追加者看到writing_后直接返回，写出者必须负责写完它们，否则空闲前的最后几条记录会滞留在内存中
+        //   返回false表示管道已满或写出失败；写出失败时丢弃已追加的数据并计入丢弃数，避免等待空间的生产者永久阻塞
+        bool combine(std::unique_lock<std::mutex> &lock)
+        {
+            bool done = true;
+            while (true)
+            {
+                if (batchDone())
+                {
+                    if (pending_.segs_.empty())
+                        break;
+                    reportDropped();
+                    batch_.clear();
+                    std::swap(batch_.data_, pending_.data_);
+                    std::swap(batch_.segs_, pending_.segs_);
+                    pendingBytes_ = 0;
+                    cond_.notify_all();
+                }
+                lock.unlock();
+                WriteResult result = writeBatch();
+                lock.lock();
+                if (result == WriteResult::FAILED)
+                {
+                    uint64_t lost = unwritten(batch_, batch_.seg_) + unwritten(pending_, 0);
+                    dropped_ += lost;
+                    stats_.drops_.add(lost);
+                    batch_.seg_ = batch_.segs_.size(); // 放弃本批
+                    pending_.clear();
+                    pendingBytes_ = 0;
+                }
+                if (result != WriteResult::DONE)
+                {
+                    done = false;
+                    break;
+                }
+            }
+            writing_ = false;
+            cond_.notify_all();
+            return done;
+        }
+
+        bool batchDone() const
+        {
+            return batch_.seg_ >= batch_.segs_.size();
+        }
+
+        // 从第from段起未写完的记录数
+        static uint64_t unwritten(const Batch &batch, size_t from)
+        {
+            uint64_t records = 0;
+            for (size_t i = from; i < batch.segs_.size(); ++i)
+                records += batch.segs_[i].records_;
+            return records;
+        }
+
+        // 调用者持有锁：丢弃过记录时在下一批前输出一条提示
+        void reportDropped()
+        {
+            if (dropped_ == reported_)
+                return;
+            char notice[64];
+            int n = snprintf(notice, sizeof(notice), "zlog: dropped %llu console records\n",
+                             static_cast<unsigned long long>(dropped_ - reported_));
+            reported_ = dropped_;
+            size_t offset = pending_.data_.size();
+            pending_.data_.insert(pending_.data_.end(), notice, notice + n);
+            pending_.segs_.push_back(Segment{nullptr, offset, static_cast<size_t>(n), 0});
+        }
+
+        enum class WriteResult
+        {
+            DONE,    // 批次已全部写出
+            AGAIN,  // 管道已满(DROP策略)，批次保留到下次
+            FAILED  // 写出失败，由调用者放弃批次
+        };
+
+        WriteResult writeBatch()
+        {
+            struct iovec iov[IOV_MAX_BATCH];
+            while (!batchDone())
+            {
+                if (policy_ == ConsolePolicy::DROP && !ownFd_)
+                {
+                    struct pollfd pfd = {fd_, POLLOUT, 0};
+                    if (poll(&pfd, 1, 0) <= 0)
+                        return WriteResult::AGAIN;
+                }
+                int count = 0;
+                for (size_t i = batch_.seg_; i < batch_.segs_.size() && count < IOV_MAX_BATCH; ++i, ++count)
+                {
+                    const Segment &seg = batch_.segs_[i];
+                    const char *base = seg.static_ != nullptr ? seg.static_ : batch_.data_.data() + seg.offset_;
+                    size_t skip = i == batch_.seg_ ? batch_.offset_ : 0;
+                    iov[count].iov_base = const_cast<char *>(base + skip);
+                    iov[count].iov_len = seg.len_ - skip;
+                }
+                ssize_t n = ::writev(fd_, iov, count);
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                        return WriteResult::AGAIN;
+                    stats_.errors_.add();
+                    std::cerr << "控制台写出失败: " << strerror(errno) << std::endl;
+                    return WriteResult::FAILED;
+                }
+                advance(static_cast<size_t>(n));
+            }
+            return WriteResult::DONE;
+        }
+
+        void advance(size_t n)
+        {
+            while (n > 0 && !batchDone())
+            {
+                size_t left = batch_.segs_[batch_.seg_].len_ - batch_.offset_;
+                if (n < left)
+                {
+                    batch_.offset_ += n;
+                    return;
+                }
+                n -= left;
+                batch_.seg_++;
+                batch_.offset_ = 0;
+            }
+        }
+
+    private:
+        static constexpr int IOV_MAX_BATCH = IOV_MAX < 1024 ? IOV_MAX : 1024;
+
+        ConsolePolicy policy_;
+        int fd_;
+        bool ownFd_; // fd_是否为重新打开的非阻塞描述符
+        bool color_;
+        size_t maxPending_; // 待写出数据上限
+        std::mutex mutex_;
+        std::condition_variable cond_;
+        Batch pending_;        // 追加中的数据
+        Batch batch_;          // 写出中的批次，只由写出者访问
+        size_t pendingBytes_;
+        bool writing_;         // 是否有线程正在写出
+        uint64_t dropped_;
+        uint64_t reported_;
+    };
+#endif
+
     class RollBySizeSink : public LogSink
     {
     public:
-        RollBySizeSink(const std::string &basename, size_t maxSize)
+        // indexInterval大于0时为每个文件按该间隔写时间索引<文件名>.idx
+        RollBySizeSink(const std::string &basename, size_t maxSize,
+                       std::chrono::milliseconds indexInterval = std::chrono::milliseconds(0))
             : basename_(basename),
               maxSize_(maxSize),
               curSize_(0),
-              nameCount_(0)
+              nameCount_(0),
+              indexInterval_(indexInterval)
         {
             // 1.创建日志文件所用的路径
             std::string pathname = createNewFile();
@@ -76,17 +684,35 @@ namespace zlog
 
             // 2. 创建并打开日志文件
             ofs_.open(pathname, std::ios::binary | std::ios::app);
+            curPath_ = pathname;
+            openIndex();
         }
 
         void log(const char *data, size_t len) override
         {
-            if (curSize_ + len > maxSize_)
-            {
-                rollOver();
-            }
-            fmt::print(ofs_, "{:.{}}", data, len);
-            ofs_.flush(); // 确保日志及时写入磁盘
-            curSize_ += len;
+            write(data, len, TimeIndex::ALL_LEVELS);
+        }
+
+        void log(LogLevel::value level, const char *data, size_t len) override
+        {
+            write(data, len, TimeIndex::levelBit(level));
+        }
+
+        void flush() override
+        {
+            ofs_.flush();
+        }
+
+        std::string name() const override
+        {
+            return basename_;
+        }
+
+        void sync() override
+        {
+            ofs_.flush();
+            if (!File::sync(curPath_))
+                std::cerr << "同步日志文件失败: " << curPath_ << std::endl;
         }
 
     protected:
@@ -110,19 +736,47 @@ namespace zlog
             return pathname;
         }
 
+        void write(const char *data, size_t len, uint32_t levels)
+        {
+            if (curSize_ + len > maxSize_)
+            {
+                rollOver();
+            }
+            ofs_.write(data, len);
+            ofs_.flush(); // 确保日志及时写入磁盘
+            if (!ofs_.good())
+                stats_.errors_.add();
+            if (index_)
+                index_->note(curSize_, len, levels);
+            curSize_ += len;
+        }
+
         void rollOver()
         {
             ofs_.close(); // 释放旧流资源
             std::string pathname = createNewFile();
             ofs_.open(pathname, std::ios::binary | std::ios::app);
+            curPath_ = pathname;
             curSize_ = 0;
+            openIndex();
+        }
+
+        // 每个文件一个索引，切换文件时写出旧索引的最后一段
+        void openIndex()
+        {
+            index_.reset();
+            if (indexInterval_.count() > 0)
+                index_.reset(new TimeIndex(curPath_, indexInterval_));
         }
 
         std::string basename_;
+        std::string curPath_; // 当前写入的文件
         std::ofstream ofs_;
         size_t maxSize_;
         size_t curSize_;
         size_t nameCount_;
+        std::chrono::milliseconds indexInterval_;
+        std::unique_ptr<TimeIndex> index_; // 未开启索引时为空
     };
 
     // 工厂类支持移动语义
@@ -0,0 +1,217 @@
+#pragma once
+#include "level.hpp"
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <algorithm>
+
+/*
+    生产者写合并
+        1. 每个线程为每个日志器持有一个暂存区，格式化后的记录先追加到暂存区
+        2. 暂存区达到容量、首条记录超过最长暂存时间、出现高等级记录或线程退出时，一次性提交到工作器
+        3. 后台定期回收长时间未提交的暂存区，回收过程只尝试加锁、不阻塞后台线程
+    加锁顺序：StageGroup::mutex_ -> WriteStage::mutex_
+*/
+namespace zlog
+{
+    // 一个线程在一个日志器上的暂存区
+    struct WriteStage
+    {
+        WriteStage(size_t capacity, int shard)
+            : first_(0), shard_(shard)
+        {
+            data_.reserve(capacity);
+        }
+
+        std::mutex mutex_;       // 持有线程与后台回收/drain之间互斥，通常无竞争
+        std::vector<char> data_; // 暂存的记录
+        int64_t first_;          // 首条记录的暂存时间(steady_clock计数)
+        const int shard_;        // 持有线程的工作器分片，由任何线程提交都写入该分片，保证同一线程的记录不乱序
+    };
+
+    class StageGroup : public std::enable_shared_from_this<StageGroup>
+    {
+    public:
+        using ptr = std::shared_ptr<StageGroup>;
+        using Clock = std::chrono::steady_clock;
+        // 提交目标：写入shard分片，block为假时不得阻塞，返回是否提交成功
+        using Target = std::function<bool(int shard, const char *data, size_t len, bool block)>;
+        // 当前线程所属的分片，创建暂存区时调用
+        using ShardOf = std::function<int()>;
+
+        StageGroup(const Target &target, const ShardOf &shardOf, size_t capacity, std::chrono::nanoseconds delay, LogLevel::value flushLevel)
+            : target_(target), shardOf_(shardOf), capacity_(capacity), delay_(std::chrono::duration_cast<Clock::duration>(delay).count()), flushLevel_(flushLevel),
+              id_(nextId()), closed_(false)
+        {
+        }
+
+        // 追加当前线程的一条记录
+        void append(LogLevel::value level, const char *data, size_t len)
+        {
+            WriteStage &stage = local();
+            std::unique_lock<std::mutex> lock(stage.mutex_);
+            int64_t now = Clock::now().time_since_epoch().count();
+            if (!stage.data_.empty() && (stage.data_.size() + len > capacity_ || now - stage.first_ >= delay_))
+                submit(stage, true);
+            // 超过暂存容量的记录直接提交
+            if (len > capacity_)
+            {
+                target_(stage.shard_, data, len, true);
+                return;
+            }
+            if (stage.data_.empty())
+                stage.first_ = now;
+            stage.data_.insert(stage.data_.end(), data, data + len);
+            if (level >= flushLevel_)
+                submit(stage, true);
+        }
+
+        // 提交当前线程的暂存区
+        void flushCurrent()
+        {
+            WriteStage &stage = local();
+            std::unique_lock<std::mutex> lock(stage.mutex_);
+            submit(stage, true);
+        }
+
+        // 提交所有线程的暂存区
+        void flushAll()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (closed_)
+                return;
+            for (auto &stage : stages_)
+            {
+                std::unique_lock<std::mutex> stageLock(stage->mutex_);
+                submit(*stage, true);
+            }
+        }
+
+        // 后台回收：提交超过最长暂存时间的暂存区；任何一步需要等待时放弃，留待下次回收
+        void collect()
+        {
+            std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+            if (!lock.owns_lock() || closed_)
+                return;
+            int64_t now = Clock::now().time_since_epoch().count();
+            for (auto &stage : stages_)
+            {
+                std::unique_lock<std::mutex> stageLock(stage->mutex_, std::try_to_lock);
+                if (stageLock.owns_lock() && !stage->data_.empty() && now - stage->first_ >= delay_)
+                    submit(*stage, false);
+            }
+        }
+
+        // 日志器析构前调用：提交全部暂存数据，此后不再向提交目标写入
+        void close()
+        {
+            flushAll();
+            std::unique_lock<std::mutex> lock(mutex_);
+            closed_ = true;
+            stages_.clear();
+        }
+
+    private:
+        struct Entry
+        {
+            uint64_t id_;
+            std::weak_ptr<StageGroup> group_;
+            std::shared_ptr<WriteStage> stage_;
+        };
+
+        // 线程退出时提交并注销本线程的全部暂存区
+        struct Cache
+        {
+            std::vector<Entry> entries_;
+            size_t last_ = 0; // 最近一次命中的下标
+
+            ~Cache()
+            {
+                for (auto &entry : entries_)
+                {
+                    StageGroup::ptr group = entry.group_.lock();
+                    if (group)
+                        group->release(entry.stage_);
+                }
+            }
+        };
+
+        static Cache &cache()
+        {
+            thread_local Cache cache;
+            return cache;
+        }
+
+        // 日志器地址可能被复用，以递增编号区分
+        static uint64_t nextId()
+        {
+            static std::atomic<uint64_t> id(0);
+            return ++id;
+        }
+
+        // 当前线程在本日志器上的暂存区，首次使用时创建并注册
+        WriteStage &local()
+        {
+            Cache &c = cache();
+            if (c.last_ < c.entries_.size() && c.entries_[c.last_].id_ == id_)
+                return *c.entries_[c.last_].stage_;
+            for (size_t i = 0; i < c.entries_.size(); ++i)
+            {
+                if (c.entries_[i].id_ == id_)
+                {
+                    c.last_ = i;
+                    return *c.entries_[i].stage_;
+                }
+            }
+
+            // 清理已销毁日志器的条目
+            c.entries_.erase(std::remove_if(c.entries_.begin(), c.entries_.end(), [](const Entry &entry)
+                                            { return entry.group_.expired(); }),
+                             c.entries_.end());
+            std::shared_ptr<WriteStage> stage = std::make_shared<WriteStage>(capacity_, shardOf_());
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                stages_.push_back(stage);
+            }
+            c.entries_.push_back(Entry{id_, shared_from_this(), stage});
+            c.last_ = c.entries_.size() - 1;
+            return *stage;
+        }
+
+        void release(const std::shared_ptr<WriteStage> &stage)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (closed_)
+                return;
+            {
+                std::unique_lock<std::mutex> stageLock(stage->mutex_);
+                submit(*stage, true);
+            }
+            stages_.erase(std::remove(stages_.begin(), stages_.end(), stage), stages_.end());
+        }
+
+        // 调用者持有stage.mutex_
+        void submit(WriteStage &stage, bool block)
+        {
+            if (stage.data_.empty())
+                return;
+            if (target_(stage.shard_, stage.data_.data(), stage.data_.size(), block))
+                stage.data_.clear();
+        }
+
+    private:
+        Target target_;
+        ShardOf shardOf_;
+        size_t capacity_;
+        int64_t delay_; // 最长暂存时间(steady_clock计数)
+        LogLevel::value flushLevel_;
+        uint64_t id_;
+        std::mutex mutex_;
+        bool closed_;
+        std::vector<std::shared_ptr<WriteStage>> stages_;
+    };
+};
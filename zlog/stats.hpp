@@ -0,0 +1,212 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/*
+    运行时统计
+        1. 计数器与直方图按线程分条带，每个线程只写自己所在的缓存行，写入为一次relaxed原子加
+        2. 读取时汇总所有条带得到快照，快照之间的差值即为区间内的增量
+        3. 直方图按2的幂分桶，记录数量、总和与最大值，可估算分位数
+*/
+namespace zlog
+{
+    static constexpr size_t STATS_STRIPES = 8;
+
+    // 当前线程使用的条带，线程首次使用时轮转分配
+    inline size_t statsStripe()
+    {
+        static std::atomic<size_t> next(0);
+        thread_local size_t stripe = next.fetch_add(1, std::memory_order_relaxed) % STATS_STRIPES;
+        return stripe;
+    }
+
+    class Counter
+    {
+    public:
+        Counter()
+        {
+            for (auto &slot : slots_)
+                slot.value_.store(0, std::memory_order_relaxed);
+        }
+
+        void add(uint64_t n = 1)
+        {
+            slots_[statsStripe()].value_.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        uint64_t value() const
+        {
+            uint64_t sum = 0;
+            for (auto &slot : slots_)
+                sum += slot.value_.load(std::memory_order_relaxed);
+            return sum;
+        }
+
+    private:
+        // 以填充而非alignas隔开缓存行，C++11的new不保证超对齐
+        struct Slot
+        {
+            std::atomic<uint64_t> value_;
+            char pad_[64 - sizeof(std::atomic<uint64_t>)];
+        };
+        Slot slots_[STATS_STRIPES];
+    };
+
+    /*直方图快照*/
+    struct HistogramSnapshot
+    {
+        static constexpr size_t BUCKETS = 64; // 第i个桶为[2^(i-1), 2^i)，第0个桶为0
+
+        uint64_t count_ = 0;
+        uint64_t sum_ = 0;
+        uint64_t max_ = 0;
+        std::vector<uint64_t> buckets_;
+
+        double mean() const
+        {
+            return count_ == 0 ? 0 : static_cast<double>(sum_) / count_;
+        }
+
+        // 估算分位数(p取0~1)，返回所在桶的上界，不超过最大值
+        uint64_t percentile(double p) const
+        {
+            if (count_ == 0)
+                return 0;
+            uint64_t rank = static_cast<uint64_t>(p * count_);
+            uint64_t seen = 0;
+            for (size_t i = 0; i < buckets_.size(); ++i)
+            {
+                seen += buckets_[i];
+                if (seen > rank)
+                    return i == 0 ? 0 : std::min<uint64_t>((1ULL << i) - 1, max_);
+            }
+            return max_;
+        }
+    };
+
+    class Histogram
+    {
+    public:
+        Histogram()
+        {
+            for (auto &stripe : stripes_)
+            {
+                stripe.count_.store(0, std::memory_order_relaxed);
+                stripe.sum_.store(0, std::memory_order_relaxed);
+                stripe.max_.store(0, std::memory_order_relaxed);
+                for (auto &bucket : stripe.buckets_)
+                    bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        void record(uint64_t value)
+        {
+            Stripe &stripe = stripes_[statsStripe()];
+            stripe.count_.fetch_add(1, std::memory_order_relaxed);
+            stripe.sum_.fetch_add(value, std::memory_order_relaxed);
+            stripe.buckets_[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+            // 同一条带上的线程很少，最大值竞争可忽略
+            uint64_t max = stripe.max_.load(std::memory_order_relaxed);
+            while (value > max && !stripe.max_.compare_exchange_weak(max, value, std::memory_order_relaxed))
+                ;
+        }
+
+        HistogramSnapshot snapshot() const
+        {
+            HistogramSnapshot snap;
+            snap.buckets_.assign(HistogramSnapshot::BUCKETS, 0);
+            for (auto &stripe : stripes_)
+            {
+                snap.count_ += stripe.count_.load(std::memory_order_relaxed);
+                snap.sum_ += stripe.sum_.load(std::memory_order_relaxed);
+                snap.max_ = std::max(snap.max_, stripe.max_.load(std::memory_order_relaxed));
+                for (size_t i = 0; i < HistogramSnapshot::BUCKETS; ++i)
+                    snap.buckets_[i] += stripe.buckets_[i].load(std::memory_order_relaxed);
+            }
+            return snap;
+        }
+
+    private:
+        static size_t bucket(uint64_t value)
+        {
+            if (value == 0)
+                return 0;
+            size_t b = 64 - __builtin_clzll(value);
+            return b < HistogramSnapshot::BUCKETS ? b : HistogramSnapshot::BUCKETS - 1;
+        }
+
+        struct Stripe
+        {
+            std::atomic<uint64_t> count_;
+            std::atomic<uint64_t> sum_;
+            std::atomic<uint64_t> max_;
+            std::atomic<uint64_t> buckets_[HistogramSnapshot::BUCKETS];
+            char pad_[64 - (3 + HistogramSnapshot::BUCKETS) * sizeof(uint64_t) % 64];
+        };
+        Stripe stripes_[STATS_STRIPES];
+    };
+
+    /*落地方向的统计*/
+    struct SinkStats
+    {
+        Counter writes_;     // 写出次数(同步为每条记录，异步为每批)
+        Counter bytes_;      // 写出字节数
+        Counter errors_;     // 写出失败次数
+        Counter drops_;      // 丢弃的记录数
+        Histogram latency_;  // 单次写出耗时(ns)
+    };
+
+    struct SinkSnapshot
+    {
+        std::string name_;
+        uint64_t writes_ = 0;
+        uint64_t bytes_ = 0;
+        uint64_t errors_ = 0;
+        uint64_t drops_ = 0;
+        HistogramSnapshot latency_;
+    };
+
+    /*异步工作器的统计*/
+    struct LooperStats
+    {
+        Counter blocked_;       // 生产者等待缓冲区空间的次数
+        Histogram blockNs_;     // 生产者每次等待的时长(ns)
+        Counter growths_;       // 生产缓冲区扩容次数(ASYNC_UNSAFE)
+        Counter large_;         // 未进入缓冲区、单独存放的大记录数
+        Histogram batchBytes_;  // 每批落地的数据量
+    };
+
+    struct LooperSnapshot
+    {
+        size_t pendingBytes_ = 0;   // 生产缓冲区中等待落地的数据量
+        size_t bufferCapacity_ = 0; // 生产缓冲区当前容量
+        uint64_t enqueued_ = 0;     // 已写入的记录数
+        uint64_t written_ = 0;      // 已落地的记录数
+        uint64_t blocked_ = 0;
+        uint64_t growths_ = 0;
+        uint64_t largeRecords_ = 0;
+        HistogramSnapshot blockNs_;
+        HistogramSnapshot batchBytes_;
+    };
+
+    struct LoggerSnapshot
+    {
+        static constexpr size_t LEVELS = 7; // 与LogLevel::value的取值一一对应
+
+        std::string name_;
+        uint64_t records_[LEVELS] = {0}; // 各等级写出的记录数
+        uint64_t bytes_[LEVELS] = {0};   // 各等级格式化后的字节数
+        std::vector<LooperSnapshot> loopers_; // 异步日志器的工作器(分片时多个)
+        std::vector<SinkSnapshot> sinks_;
+    };
+
+    struct StatsSnapshot
+    {
+        std::chrono::system_clock::time_point time_;
+        std::vector<LoggerSnapshot> loggers_;
+    };
+};
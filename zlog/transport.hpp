@@ -0,0 +1,545 @@
+#pragma once
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "sink.hpp"
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <new>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <signal.h>
+#endif
+
+/*
+    多进程日志的传输方式，由zlog-collector(见collector.hpp)汇总写入真正的落地方向
+        1. 共享内存环：每个进程在目录下创建<pid>.ring，记录以[4字节长度][数据]的帧写入单生产者单消费者环，
+           收集进程映射所有环并轮流读取；进程fork后在子进程中首次写入时为子进程新建环
+        2. Unix域数据报：每次log的数据按行切分为不超过maxDatagram的数据报，以sendmmsg一次系统调用批量发出，
+           配合异步日志器或写合并使用时一次调用即可携带大量记录
+    两者都不持有后台线程，预派生的工作进程使用同步日志器即可
+*/
+namespace zlog
+{
+#ifndef _WIN32
+    struct ShmRingHeader
+    {
+        char magic_[8]; // "ZLOGSHMR"
+        uint32_t version_;
+        uint32_t headerSize_;
+        uint64_t capacity_;
+        int64_t pid_;
+        std::atomic<uint32_t> closed_;   // 写入进程已关闭环
+        std::atomic<uint64_t> dropped_;  // 环满被丢弃的记录数
+        std::atomic<int64_t> beat_;      // 收集进程最近一次读取的时间(CLOCK_MONOTONIC纳秒)，0表示尚未连接
+        char pad0_[64];
+        std::atomic<uint64_t> head_;     // 写入位置，只由写入进程修改
+        char pad1_[64 - sizeof(std::atomic<uint64_t>)];
+        std::atomic<uint64_t> tail_;     // 读取位置，只由收集进程修改
+    };
+
+    class ShmRing
+    {
+    public:
+        using ptr = std::shared_ptr<ShmRing>;
+        static constexpr uint32_t SHM_VERSION = 1;
+        static constexpr size_t SHM_HEADER_SIZE = 4096;
+        static constexpr size_t FRAME_HEADER = sizeof(uint32_t);
+
+        // 收集进程在监视目录下写入自己的进程号，新环被发现之前写入进程据此判断是否等待
+        static std::string collectorPidFile(const std::string &dir)
+        {
+            return dir + "/collector.pid";
+        }
+
+        // 写入进程：在dir下为当前进程创建环
+        static ShmRing::ptr create(const std::string &dir, size_t capacity)
+        {
+            ShmRing::ptr ring(new ShmRing());
+            std::string path = fmt::format("{}/{}.ring", dir, getpid());
+            std::string tmp = path + ".tmp";
+            File::createDirectory(dir);
+            int fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0 || ftruncate(fd, static_cast<off_t>(SHM_HEADER_SIZE + capacity)) != 0 || !ring->map(fd, SHM_HEADER_SIZE + capacity))
+            {
+                std::cerr << "创建共享内存环失败: " << tmp << " " << strerror(errno) << std::endl;
+                if (fd >= 0)
+                    ::close(fd);
+                unlink(tmp.c_str());
+                return ShmRing::ptr();
+            }
+            ::close(fd);
+            ShmRingHeader *header = new (ring->base_) ShmRingHeader();
+            header->version_ = SHM_VERSION;
+            header->headerSize_ = SHM_HEADER_SIZE;
+            header->capacity_ = capacity;
+            header->pid_ = static_cast<int64_t>(getpid());
+            header->closed_.store(0, std::memory_order_relaxed);
+            header->dropped_.store(0, std::memory_order_relaxed);
+            header->beat_.store(0, std::memory_order_relaxed);
+            header->head_.store(0, std::memory_order_relaxed);
+            header->tail_.store(0, std::memory_order_relaxed);
+            memcpy(header->magic_, "ZLOGSHMR", 8);
+            ring->attach(path);
+            std::ifstream pidFile(collectorPidFile(dir));
+            pidFile >> ring->collectorPid_;
+            // 初始化完成后改名，收集进程看不到未初始化的环
+            if (rename(tmp.c_str(), path.c_str()) != 0)
+            {
+                std::cerr << "发布共享内存环失败: " << path << " " << strerror(errno) << std::endl;
+                unlink(tmp.c_str());
+                return ShmRing::ptr();
+            }
+            return ring;
+        }
+
+        // 收集进程：映射已有的环，格式不符时返回空
+        static ShmRing::ptr open(const std::string &path)
+        {
+            int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+            if (fd < 0)
+                return ShmRing::ptr();
+            struct stat st;
+            ShmRing::ptr ring(new ShmRing());
+            bool ok = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) > SHM_HEADER_SIZE &&
+                      ring->map(fd, static_cast<size_t>(st.st_size));
+            ::close(fd);
+            if (!ok)
+                return ShmRing::ptr();
+            ShmRingHeader *header = ring->header();
+            if (memcmp(header->magic_, "ZLOGSHMR", 8) != 0 || header->version_ != SHM_VERSION ||
+                header->headerSize_ + header->capacity_ != ring->size_)
+                return ShmRing::ptr();
+            ring->inode_ = static_cast<uint64_t>(st.st_ino);
+            ring->attach(path);
+            return ring;
+        }
+
+        ~ShmRing()
+        {
+            if (base_ != nullptr)
+                munmap(base_, size_);
+        }
+
+        ShmRing(const ShmRing &) = delete;
+        ShmRing &operator=(const ShmRing &) = delete;
+
+        /*
+            写入一条记录，调用者保证串行
+                环满时若收集进程在线则等待，否则丢弃并计数；block为假时直接丢弃
+        */
+        bool write(const char *data, size_t len, bool block)
+        {
+            ShmRingHeader *h = header();
+            size_t need = FRAME_HEADER + len;
+            if (need > capacity_)
+            {
+                h->dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            uint64_t head = h->head_.load(std::memory_order_relaxed);
+            size_t spins = 0;
+            while (capacity_ - static_cast<size_t>(head - h->tail_.load(std::memory_order_acquire)) < need)
+            {
+                if (!block || !collectorAlive())
+                {
+                    h->dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                if (++spins < 64)
+                    std::this_thread::yield();
+                else
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+            uint32_t frame = static_cast<uint32_t>(len);
+            copyIn(head, reinterpret_cast<const char *>(&frame), FRAME_HEADER);
+            copyIn(head + FRAME_HEADER, data, len);
+            h->head_.store(head + need, std::memory_order_release);
+            return true;
+        }
+
+        // 收集进程：读取至多max字节的完整记录追加到out，返回读取的字节数
+        size_t read(std::vector<char> &out, size_t max)
+        {
+            ShmRingHeader *h = header();
+            uint64_t tail = h->tail_.load(std::memory_order_relaxed);
+            uint64_t head = h->head_.load(std::memory_order_acquire);
+            size_t total = 0;
+            while (tail < head)
+            {
+                uint32_t len = 0;
+                copyOut(tail, reinterpret_cast<char *>(&len), FRAME_HEADER);
+                if (FRAME_HEADER + len > head - tail)
+                {
+                    // 帧损坏：丢弃环中剩余数据
+                    tail = head;
+                    break;
+                }
+                if (total != 0 && total + len > max)
+                    break;
+                size_t offset = out.size();
+                out.resize(offset + len);
+                copyOut(tail + FRAME_HEADER, out.data() + offset, len);
+                tail += FRAME_HEADER + len;
+                total += len;
+            }
+            h->tail_.store(tail, std::memory_order_release);
+            return total;
+        }
+
+        // 收集进程：刷新心跳，写入进程据此判断环满时是否值得等待
+        void beat()
+        {
+            header()->beat_.store(now(), std::memory_order_relaxed);
+        }
+
+        // 写入进程：标记关闭，收集进程读完后删除文件
+        void close()
+        {
+            header()->closed_.store(1, std::memory_order_release);
+        }
+
+        bool closed() const
+        {
+            return header()->closed_.load(std::memory_order_acquire) != 0;
+        }
+
+        bool empty() const
+        {
+            return header()->head_.load(std::memory_order_acquire) == header()->tail_.load(std::memory_order_relaxed);
+        }
+
+        uint64_t dropped() const
+        {
+            return header()->dropped_.load(std::memory_order_relaxed);
+        }
+
+        int64_t pid() const
+        {
+            return header()->pid_;
+        }
+
+        uint64_t inode() const
+        {
+            return inode_;
+        }
+
+        const std::string &path() const
+        {
+            return path_;
+        }
+
+    private:
+        ShmRing()
+            : base_(nullptr), size_(0), capacity_(0), inode_(0), collectorPid_(0)
+        {
+        }
+
+        bool map(int fd, size_t size)
+        {
+            void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (base == MAP_FAILED)
+                return false;
+            base_ = static_cast<char *>(base);
+            size_ = size;
+            return true;
+        }
+
+        void attach(const std::string &path)
+        {
+            path_ = path;
+            capacity_ = static_cast<size_t>(header()->capacity_);
+        }
+
+        ShmRingHeader *header() const
+        {
+            return reinterpret_cast<ShmRingHeader *>(base_);
+        }
+
+        char *data() const
+        {
+            return base_ + SHM_HEADER_SIZE;
+        }
+
+        void copyIn(uint64_t pos, const char *src, size_t len)
+        {
+            size_t offset = static_cast<size_t>(pos % capacity_);
+            size_t first = std::min(len, capacity_ - offset);
+            memcpy(data() + offset, src, first);
+            memcpy(data(), src + first, len - first);
+        }
+
+        void copyOut(uint64_t pos, char *dst, size_t len) const
+        {
+            size_t offset = static_cast<size_t>(pos % capacity_);
+            size_t first = std::min(len, capacity_ - offset);
+            memcpy(dst, data() + offset, first);
+            memcpy(dst + first, data(), len - first);
+        }
+
+        static int64_t now()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+        }
+
+        // 已连接时看心跳；尚未被发现时看收集进程是否存在
+        bool collectorAlive() const
+        {
+            static const int64_t TIMEOUT = 2000000000LL; // 心跳超过2秒未更新视为收集进程不在线
+            int64_t beat = header()->beat_.load(std::memory_order_relaxed);
+            if (beat != 0)
+                return now() - beat < TIMEOUT;
+            return collectorPid_ > 0 && kill(static_cast<pid_t>(collectorPid_), 0) == 0;
+        }
+
+        char *base_;
+        size_t size_;
+        size_t capacity_;
+        uint64_t inode_;
+        int64_t collectorPid_; // 创建时记录的收集进程，0表示没有
+        std::string path_;
+    };
+
+    namespace detail
+    {
+        // 在不超过max字节的最后一个换行处切分，返回切分点；一行超长时硬切
+        inline const char *splitAtLine(const char *begin, const char *end, size_t max)
+        {
+            if (static_cast<size_t>(end - begin) <= max)
+                return end;
+            const char *limit = begin + max;
+            for (const char *p = limit; p > begin; --p)
+                if (p[-1] == '\n')
+                    return p;
+            return limit;
+        }
+    }
+
+    /*
+        写入共享内存环的落地方向
+            1. 每条log调用按行切分为不超过环容量四分之一的帧，收集进程按帧转写，不同进程的记录不会交错；
+               异步日志器整批写入时批次可能远大于环，超长的单行会被拆成多帧
+            2. fork之后子进程首次写入时为自己创建新环，父进程的环保持不变
+    */
+    class ShmRingSink : public LogSink
+    {
+    public:
+        static constexpr size_t DEFAULT_RING_SIZE = 1024 * 1024 * 4;
+
+        // dir为收集进程监视的目录；block为真时环满且收集进程在线则等待
+        ShmRingSink(const std::string &dir, size_t capacity = DEFAULT_RING_SIZE, bool block = true)
+            : dir_(dir), capacity_(capacity), block_(block), generation_(forkGeneration())
+        {
+            registerAtFork();
+            ring_ = ShmRing::create(dir_, capacity_);
+        }
+
+        ~ShmRingSink()
+        {
+            // 只关闭本进程创建的环
+            if (ring_ && generation_ == forkGeneration())
+                ring_->close();
+        }
+
+        void log(const char *data, size_t len) override
+        {
+            if (generation_ != forkGeneration())
+            {
+                generation_ = forkGeneration();
+                ring_ = ShmRing::create(dir_, capacity_);
+            }
+            if (!ring_)
+            {
+                stats_.errors_.add();
+                return;
+            }
+            const char *end = data + len;
+            size_t maxFrame = std::max<size_t>(capacity_ / 4, 1);
+            while (data < end)
+            {
+                const char *frameEnd = detail::splitAtLine(data, end, maxFrame);
+                if (!ring_->write(data, static_cast<size_t>(frameEnd - data), block_))
+                {
+                    stats_.drops_.add();
+                    return;
+                }
+                data = frameEnd;
+            }
+        }
+
+        std::string name() const override
+        {
+            return ring_ ? ring_->path() : dir_;
+        }
+
+    private:
+        // 子进程中递增，用于发现fork
+        static std::atomic<uint64_t> &generationCounter()
+        {
+            static std::atomic<uint64_t> generation(0);
+            return generation;
+        }
+
+        static uint64_t forkGeneration()
+        {
+            return generationCounter().load(std::memory_order_relaxed);
+        }
+
+        static void registerAtFork()
+        {
+            static std::once_flag once;
+            std::call_once(once, []()
+                           { pthread_atfork(nullptr, nullptr, []()
+                                            { generationCounter().fetch_add(1, std::memory_order_relaxed); }); });
+        }
+
+        std::string dir_;
+        size_t capacity_;
+        bool block_;
+        uint64_t generation_;
+        ShmRing::ptr ring_;
+    };
+
+    /*
+        Unix域数据报落地方向
+            1. 数据按行切分为不超过maxDatagram的数据报，同一次log的所有数据报以sendmmsg一次发出
+            2. 数据报套接字在收集进程接收队列满时阻塞发送方，形成背压
+            3. 收集进程不在线时丢弃并计数，之后的写入自动重连
+            超过maxDatagram的单行会被拆成多个数据报，可能与其他进程的记录交错
+    */
+    class UdsSink : public LogSink
+    {
+    public:
+        static constexpr size_t MAX_DATAGRAM = 1024 * 64; // 与收集进程的接收缓冲区一致
+        static constexpr size_t DEFAULT_DATAGRAM = 1024 * 16;
+        static constexpr size_t SEND_BATCH = 64; // 每次sendmmsg的数据报数
+
+        UdsSink(const std::string &path, size_t maxDatagram = DEFAULT_DATAGRAM)
+            : path_(path), fd_(-1), maxDatagram_(std::min(std::max<size_t>(maxDatagram, 1), MAX_DATAGRAM))
+        {
+            connect();
+        }
+
+        ~UdsSink()
+        {
+            if (fd_ >= 0)
+                ::close(fd_);
+        }
+
+        void log(const char *data, size_t len) override
+        {
+            if (fd_ < 0 && !connect())
+            {
+                stats_.drops_.add();
+                return;
+            }
+            const char *end = data + len;
+            while (data < end)
+            {
+                // 组装一批数据报
+                size_t count = 0;
+                while (data < end && count < SEND_BATCH)
+                {
+                    const char *chunkEnd = split(data, end);
+                    iov_[count].iov_base = const_cast<char *>(data);
+                    iov_[count].iov_len = static_cast<size_t>(chunkEnd - data);
+                    count++;
+                    data = chunkEnd;
+                }
+                if (!send(count))
+                {
+                    stats_.drops_.add();
+                    return;
+                }
+            }
+        }
+
+        std::string name() const override
+        {
+            return "uds:" + path_;
+        }
+
+    private:
+        bool connect()
+        {
+            if (fd_ < 0)
+                fd_ = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+            if (fd_ < 0)
+                return false;
+            struct sockaddr_un addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            strncpy(addr.sun_path, path_.c_str(), sizeof(addr.sun_path) - 1);
+            if (::connect(fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0)
+            {
+                ::close(fd_);
+                fd_ = -1;
+                return false;
+            }
+            return true;
+        }
+
+        // 不超过maxDatagram_的最后一个换行处切分；一行超长时硬切
+        const char *split(const char *begin, const char *end) const
+        {
+            return detail::splitAtLine(begin, end, maxDatagram_);
+        }
+
+        // 发送iov_中的count个数据报；失败时断开，下次写入重连
+        bool send(size_t count)
+        {
+            size_t sent = 0;
+            while (sent < count)
+            {
+#ifdef __linux__
+                struct mmsghdr msgs[SEND_BATCH];
+                memset(msgs, 0, sizeof(struct mmsghdr) * (count - sent));
+                for (size_t i = sent; i < count; ++i)
+                {
+                    msgs[i - sent].msg_hdr.msg_iov = &iov_[i];
+                    msgs[i - sent].msg_hdr.msg_iovlen = 1;
+                }
+                int n = sendmmsg(fd_, msgs, static_cast<unsigned int>(count - sent), 0);
+#else
+                struct msghdr msg;
+                memset(&msg, 0, sizeof(msg));
+                msg.msg_iov = &iov_[sent];
+                msg.msg_iovlen = 1;
+                int n = sendmsg(fd_, &msg, 0) < 0 ? -1 : 1;
+#endif
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    stats_.errors_.add();
+                    ::close(fd_);
+                    fd_ = -1;
+                    return false;
+                }
+                sent += static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+        std::string path_;
+        int fd_;
+        size_t maxDatagram_;
+        struct iovec iov_[SEND_BATCH];
+    };
+#endif
+};
@@ -3,12 +3,33 @@
 #include <string>
 #include <chrono>
 #include <atomic>
+#include <cstdint>
+#include <algorithm>
+#include <thread>
+#include <sstream>
+#include <fstream>
+#include <vector>
 #ifdef _WIN32
 #include <direct.h>
+#include <Windows.h>
 #else
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#endif
+#ifdef __linux__
+#include <linux/futex.h>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <climits>
+#include <ctime>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
 #endif
 
 namespace zlog
@@ -16,6 +37,9 @@ namespace zlog
     /*
         1. 关于日期的常用接口
         2. 关于文件的常用接口
+        3. 关于线程的常用接口
+        4. 关于等待与唤醒的常用接口
+        5. 关于线程调度与NUMA的常用接口
     */
 
     class Date
@@ -82,6 +106,21 @@ namespace zlog
             }
         }
 
+        /*将文件数据同步到存储设备；fsync作用于文件本身，与写入使用的描述符无关*/
+        static bool sync(const std::string &pathname)
+        {
+#ifdef _WIN32
+            return true;
+#else
+            int fd = open(pathname.c_str(), O_WRONLY | O_CLOEXEC);
+            if (fd < 0)
+                return false;
+            bool ok = fsync(fd) == 0;
+            close(fd);
+            return ok;
+#endif
+        }
+
     private:
         static void makeDir(const std::string &pathname)
         {
@@ -92,4 +131,228 @@ namespace zlog
 #endif
         }
     };
+
+    /*线程信息：每个线程首次使用时渲染一次，之后格式化只做拷贝*/
+    class ThreadInfo
+    {
+    public:
+        static ThreadInfo &current()
+        {
+            thread_local ThreadInfo info;
+            return info;
+        }
+
+        // std::thread::id 的字符串形式
+        const std::string &idStr() const
+        {
+            return idStr_;
+        }
+
+        // 内核线程ID(gettid)的字符串形式
+        const std::string &tidStr() const
+        {
+            return tidStr_;
+        }
+
+        // 线程名称，未设置时使用内核线程ID
+        const std::string &name() const
+        {
+            return name_.empty() ? tidStr_ : name_;
+        }
+
+        void setName(const std::string &name)
+        {
+            name_ = name;
+        }
+
+    private:
+        ThreadInfo()
+        {
+            std::ostringstream ss;
+            ss << std::this_thread::get_id();
+            idStr_ = ss.str();
+#ifdef _WIN32
+            tidStr_ = std::to_string(GetCurrentThreadId());
+#elif defined(SYS_gettid)
+            tidStr_ = std::to_string(static_cast<long>(syscall(SYS_gettid)));
+#else
+            tidStr_ = idStr_;
+#endif
+        }
+
+        std::string idStr_;
+        std::string tidStr_;
+        std::string name_;
+    };
+
+    /*设置当前线程名称，供 %N 输出；同时设置系统线程名(截断为15字节)便于调试器查看*/
+    inline void setThreadName(const std::string &name)
+    {
+        ThreadInfo::current().setName(name);
+#if defined(__linux__)
+        pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#endif
+    }
+
+    /*自旋等待时让出流水线资源*/
+    inline void cpuRelax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    /*基于futex的等待与唤醒，非Linux平台退化为短暂睡眠*/
+    class Futex
+    {
+    public:
+        // 当*addr仍等于expected时睡眠，直到被唤醒或超时
+        static void wait(std::atomic<uint32_t> &addr, uint32_t expected, std::chrono::nanoseconds timeout)
+        {
+#ifdef __linux__
+            struct timespec ts;
+            ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+            ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&addr), FUTEX_WAIT_PRIVATE, expected, &ts, nullptr, 0);
+#else
+            if (addr.load() == expected)
+                std::this_thread::sleep_for(std::min(timeout, std::chrono::nanoseconds(100000)));
+#endif
+        }
+
+        static void wakeOne(std::atomic<uint32_t> &addr)
+        {
+#ifdef __linux__
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&addr), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#endif
+        }
+
+        static void wakeAll(std::atomic<uint32_t> &addr)
+        {
+#ifdef __linux__
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&addr), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+        }
+    };
+
+    /*后台线程的调度配置，未设置的项保持系统默认*/
+    struct ThreadOptions
+    {
+        std::vector<int> cpus_;   // CPU亲和性，为空不绑定
+        int nice_ = 0;            // nice值，仅SCHED_OTHER有效
+        bool niceSet_ = false;
+        int policy_ = -1;         // 调度策略(SCHED_FIFO/SCHED_RR等)，-1不修改
+        int priority_ = 0;        // 实时调度优先级
+        std::string name_;        // 线程名称(截断为15字节)
+    };
+
+    class Thread
+    {
+    public:
+        // 在目标线程内调用，将调度配置应用到当前线程；失败时输出原因并继续
+        static void apply(const ThreadOptions &options)
+        {
+            if (!options.name_.empty())
+                setThreadName(options.name_);
+#ifdef __linux__
+            if (!options.cpus_.empty())
+            {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (int cpu : options.cpus_)
+                    CPU_SET(cpu, &set);
+                if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+                    std::cerr << "设置线程CPU亲和性失败" << std::endl;
+            }
+            if (options.policy_ >= 0)
+            {
+                struct sched_param param;
+                param.sched_priority = options.priority_;
+                if (pthread_setschedparam(pthread_self(), options.policy_, &param) != 0)
+                    std::cerr << "设置线程调度策略失败" << std::endl;
+            }
+            if (options.niceSet_ && setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), options.nice_) != 0)
+                std::cerr << "设置线程nice值失败" << std::endl;
+#endif
+        }
+    };
+
+    /*NUMA拓扑与内存放置，直接使用系统调用，不依赖libnuma*/
+    class Numa
+    {
+    public:
+        // 系统中的NUMA节点数，无法获取时为1
+        static int nodeCount()
+        {
+            static const int count = countNodes();
+            return count;
+        }
+
+        // 节点上的CPU列表
+        static std::vector<int> cpusOfNode(int node)
+        {
+            std::vector<int> cpus;
+            std::ifstream ifs("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string list;
+            if (!std::getline(ifs, list))
+                return cpus;
+            // 格式如 0-3,8-11
+            std::stringstream ss(list);
+            std::string range;
+            while (std::getline(ss, range, ','))
+            {
+                size_t dash = range.find('-');
+                int first = std::stoi(range.substr(0, dash));
+                int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                for (int cpu = first; cpu <= last; ++cpu)
+                    cpus.push_back(cpu);
+            }
+            return cpus;
+        }
+
+        // 当前线程所在的节点；每隔一定次数才重新查询，线程迁移后短时间内可能仍返回旧节点
+        static int currentNode()
+        {
+#if defined(__linux__) && defined(SYS_getcpu)
+            thread_local unsigned node = 0;
+            thread_local unsigned calls = 0;
+            if ((calls++ & 63) == 0)
+            {
+                unsigned cpu = 0;
+                if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+                    node = 0;
+            }
+            return static_cast<int>(node);
+#else
+            return 0;
+#endif
+        }
+
+        // 将[addr, addr+len)所在页绑定到节点并迁移已分配的页
+        static bool bind(void *addr, size_t len, int node)
+        {
+#if defined(__linux__) && defined(SYS_mbind)
+            if (node < 0 || node >= static_cast<int>(sizeof(unsigned long) * 8) || len == 0)
+                return false;
+            long page = sysconf(_SC_PAGESIZE);
+            uintptr_t begin = reinterpret_cast<uintptr_t>(addr) & ~(static_cast<uintptr_t>(page) - 1);
+            uintptr_t end = reinterpret_cast<uintptr_t>(addr) + len;
+            unsigned long mask = 1UL << node;
+            return syscall(SYS_mbind, begin, end - begin, MPOL_BIND, &mask, sizeof(mask) * 8, MPOL_MF_MOVE) == 0;
+#else
+            return false;
+#endif
+        }
+
+    private:
+        static int countNodes()
+        {
+            int count = 0;
+            while (File::exists("/sys/devices/system/node/node" + std::to_string(count)))
+                count++;
+            return count == 0 ? 1 : count;
+        }
+    };
 };
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 #include "logger.hpp"
+#include "reporter.hpp"
+#include "transport.hpp"
 namespace zlog
 {
     // 1. 提供获取指定日志器的全局接口--避免用户使用单例对象创建
@@ -7,11 +9,77 @@ namespace zlog
     {
         return LoggerManager::getInstance().getLogger(name);
     }
+    inline Logger::ptr getLogger(const char *name)
+    {
+        return LoggerManager::getInstance().getLogger(name);
+    }
     inline Logger::ptr rootLogger()
     {
         return LoggerManager::getInstance().rootLogger();
     }
 
+    // 运行时修改层级等级，例如 zlog::setLevel("net.http", zlog::LogLevel::value::DEBUG)
+    inline void setLevel(const std::string &name, LogLevel::value level)
+    {
+        LoggerManager::getInstance().setLevel(name, level);
+    }
+    inline void resetLevel(const std::string &name)
+    {
+        LoggerManager::getInstance().resetLevel(name);
+    }
+
+    // 所有已注册日志器在调用前写入的记录全部落地(sync为真时同步到存储设备)后就绪
+    inline std::future<void> flushAll(bool sync = false)
+    {
+        std::vector<Logger::ptr> loggers = LoggerManager::getInstance().loggers();
+        std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
+        std::shared_ptr<std::atomic<size_t>> left = std::make_shared<std::atomic<size_t>>(loggers.size() + 1);
+        std::function<void()> done = [promise, left]()
+        {
+            if (left->fetch_sub(1) == 1)
+                promise->set_value();
+        };
+        std::future<void> future = promise->get_future();
+        for (auto &logger : loggers)
+            logger->flush(done, sync);
+        done(); // 没有日志器时也能就绪
+        return future;
+    }
+
+    /*
+        限时退出：在timeout内落地并同步全部日志，再停止所有已注册日志器的后台工作器
+            每个日志器在独立线程中停止；到期仍未停止的(通常是落地方向卡住)被有意泄漏，
+            其工作线程脱离等待，进程退出时不再析构、也不再等待它们
+        全部在期限内完成时返回true；调用后不应再写日志
+    */
+    inline bool shutdown(std::chrono::milliseconds timeout = std::chrono::milliseconds(3000))
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        bool ok = flushAll(true).wait_until(deadline) == std::future_status::ready;
+
+        std::vector<Logger::ptr> loggers = LoggerManager::getInstance().loggers();
+        std::vector<std::future<void>> stopped;
+        for (auto &logger : loggers)
+        {
+            std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
+            stopped.push_back(promise->get_future());
+            std::thread([logger, promise]()
+                        {
+                logger->stop();
+                promise->set_value(); })
+                .detach();
+        }
+        for (size_t i = 0; i < loggers.size(); ++i)
+        {
+            if (stopped[i].wait_until(deadline) == std::future_status::ready)
+                continue;
+            ok = false;
+            // 停止线程仍在使用该日志器，保留一份引用使其永不析构
+            new Logger::ptr(loggers[i]);
+        }
+        return ok;
+    }
+
 // 2. 通过宏函数对日志器的接口进行代理
 #define ZLOG_DEBUG(fmt, ...) logImpl(zlog::LogLevel::value::DEBUG, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
 #define ZLOG_INFO(fmt, ...) logImpl(zlog::LogLevel::value::INFO, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
@@ -19,6 +87,13 @@ namespace zlog
 #define ZLOG_ERROR(fmt, ...) logImpl(zlog::LogLevel::value::ERROR, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
 #define ZLOG_FATAL(fmt, ...) logImpl(zlog::LogLevel::value::FATAL, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
 
+// 结构化日志：logger->ZLOG_INFO_KV("msg", zlog::kv("user", id), zlog::kv("lat_us", t))
+#define ZLOG_DEBUG_KV(msg, ...) logKvImpl(zlog::LogLevel::value::DEBUG, __FILE__, __LINE__, msg, ##__VA_ARGS__)
+#define ZLOG_INFO_KV(msg, ...) logKvImpl(zlog::LogLevel::value::INFO, __FILE__, __LINE__, msg, ##__VA_ARGS__)
+#define ZLOG_WARN_KV(msg, ...) logKvImpl(zlog::LogLevel::value::WARNING, __FILE__, __LINE__, msg, ##__VA_ARGS__)
+#define ZLOG_ERROR_KV(msg, ...) logKvImpl(zlog::LogLevel::value::ERROR, __FILE__, __LINE__, msg, ##__VA_ARGS__)
+#define ZLOG_FATAL_KV(msg, ...) logKvImpl(zlog::LogLevel::value::FATAL, __FILE__, __LINE__, msg, ##__VA_ARGS__)
+
 // 3. 提供宏函数，直接通过默认日志器打印
 #define DEBUG(fmt, ...) zlog::rootLogger()->ZLOG_DEBUG(fmt, ##__VA_ARGS__)
 #define INFO(fmt, ...) zlog::rootLogger()->ZLOG_INFO(fmt, ##__VA_ARGS__)
@@ -26,4 +101,10 @@ namespace zlog
 #define ERROR(fmt, ...) zlog::rootLogger()->ZLOG_ERROR(fmt, ##__VA_ARGS__)
 #define FATAL(fmt, ...) zlog::rootLogger()->ZLOG_FATAL(fmt, ##__VA_ARGS__)
 
+#define DEBUG_KV(msg, ...) zlog::rootLogger()->ZLOG_DEBUG_KV(msg, ##__VA_ARGS__)
+#define INFO_KV(msg, ...) zlog::rootLogger()->ZLOG_INFO_KV(msg, ##__VA_ARGS__)
+#define WARN_KV(msg, ...) zlog::rootLogger()->ZLOG_WARN_KV(msg, ##__VA_ARGS__)
+#define ERROR_KV(msg, ...) zlog::rootLogger()->ZLOG_ERROR_KV(msg, ##__VA_ARGS__)
+#define FATAL_KV(msg, ...) zlog::rootLogger()->ZLOG_FATAL_KV(msg, ##__VA_ARGS__)
+
 };
\ No newline at end of file